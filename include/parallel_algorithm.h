@@ -0,0 +1,432 @@
+#ifndef PARALLEL_ALGORITHM_H
+#define PARALLEL_ALGORITHM_H
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+/*
+在指定 ThreadPool 上运行的并行算法，接口与标准库并行算法类似，执行策略绑定到线程池：
+ThreadPool pool;
+pool.start(8);
+parallel::sort(parallel::par_on(pool), v.begin(), v.end());
+parallel::inclusive_scan(parallel::par_on(pool), v.begin(), v.end(), out.begin());
+long dot = parallel::transform_reduce(parallel::par_on(pool), a.begin(), a.end(), b.begin(), 0L);
+
+调用线程也参与执行分块，分块由调用线程和线程池线程共同领取，调用线程只等待已经开始执行的分块，
+因此线程池繁忙或任务队列已满时退化为串行执行，不会死锁。
+*/
+namespace parallel
+{
+    // 每个分块的目标字节数，按 L2 缓存的一部分估算，分块太小调度开销大，太大负载不均衡
+    const size_t CACHE_BLOCK_BYTES = 64 * 1024;
+
+    // 绑定到线程池的执行策略
+    class ParallelPolicy
+    {
+    public:
+        // concurrency 为参与计算的线程数量（包括调用线程），0 表示线程池线程数量 + 1
+        // 按需创建线程时线程可能还没有创建，取当前线程数量和初始线程数量中较大的一个
+        ParallelPolicy(ThreadPool &pool, int concurrency)
+            : pool_(pool), concurrency_(concurrency > 0 ? concurrency : std::max(pool.getThreadSize(), pool.getInitThreadSize()) + 1)
+        {
+        }
+
+        ThreadPool &pool() const { return pool_; }
+        int concurrency() const { return concurrency_; }
+
+    private:
+        ThreadPool &pool_;
+        int concurrency_;
+    };
+
+    inline ParallelPolicy par_on(ThreadPool &pool, int concurrency = 0)
+    {
+        return ParallelPolicy(pool, concurrency);
+    }
+
+    namespace detail
+    {
+        // 一组分块任务的共享状态，调用线程和线程池线程通过 next_ 领取分块
+        class BlockJob
+        {
+        public:
+            BlockJob(size_t count, std::function<void(size_t)> func)
+                : count_(count), func_(std::move(func)), next_(0), done_(0) {}
+
+            // 领取并执行分块，直到没有剩余分块
+            void work()
+            {
+                for (;;)
+                {
+                    size_t block = next_++;
+                    if (block >= count_)
+                        return;
+                    try
+                    {
+                        func_(block);
+                    }
+                    catch (...)
+                    {
+                        std::unique_lock<std::mutex> lock(mtx_);
+                        if (!error_)
+                            error_ = std::current_exception();
+                    }
+                    if (++done_ == count_)
+                    {
+                        std::unique_lock<std::mutex> lock(mtx_);
+                        cond_.notify_all();
+                    }
+                }
+            }
+
+            // 等待所有分块执行完毕，重新抛出分块中的第一个异常
+            void wait()
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mtx_);
+                    cond_.wait(lock, [&]() -> bool
+                               { return done_ == count_; });
+                }
+                if (error_)
+                    std::rethrow_exception(error_);
+            }
+
+        private:
+            size_t count_;
+            std::function<void(size_t)> func_;
+            std::atomic<size_t> next_;
+            std::atomic<size_t> done_;
+            std::exception_ptr error_;
+            std::mutex mtx_;
+            std::condition_variable cond_;
+        };
+
+        class BlockTask : public Task
+        {
+        public:
+            explicit BlockTask(std::shared_ptr<BlockJob> job) : job_(std::move(job)) {}
+            Any run() override
+            {
+                job_->work();
+                return 0;
+            }
+
+        private:
+            std::shared_ptr<BlockJob> job_;
+        };
+
+        // 并行执行 func(0) .. func(count - 1)，返回时全部执行完毕
+        inline void forEachBlock(const ParallelPolicy &policy, size_t count, std::function<void(size_t)> func)
+        {
+            if (count == 0)
+                return;
+            if (count == 1 || policy.concurrency() <= 1)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    func(i);
+                }
+                return;
+            }
+            auto job = std::make_shared<BlockJob>(count, std::move(func));
+            size_t helpers = std::min(count, (size_t)policy.concurrency()) - 1;
+            for (size_t i = 0; i < helpers; i++)
+            {
+                // 不等待任务队列空余，提交失败时调用线程立即执行剩下的分块
+                if (!policy.pool().trySubmitTask(policy.pool().makeTask<BlockTask>(job)).isValid())
+                    break;
+            }
+            job->work();
+            job->wait();
+        }
+
+        // 每个分块的元素个数：分块不超过 CACHE_BLOCK_BYTES，数据量较小时按并发度均分，
+        // 总量不足一个分块时不拆分
+        template <typename T>
+        size_t blockSize(const ParallelPolicy &policy, size_t n)
+        {
+            size_t cacheElems = std::max<size_t>(1, CACHE_BLOCK_BYTES / sizeof(T));
+            if (n <= cacheElems)
+                return std::max<size_t>(1, n);
+            size_t concurrency = (size_t)policy.concurrency();
+            return std::min(cacheElems, (n + concurrency - 1) / concurrency);
+        }
+
+        // 把相邻的有序区间两两并行合并，直到只剩一个区间
+        // bounds 为区间边界，mergeFunc(first, middle, last) 合并 [first, middle) 和 [middle, last)
+        template <typename RandomIt, typename MergeFunc>
+        void mergeTree(const ParallelPolicy &policy, std::vector<RandomIt> bounds, MergeFunc mergeFunc)
+        {
+            while (bounds.size() > 2)
+            {
+                size_t runs = bounds.size() - 1;
+                size_t pairs = runs / 2;
+                forEachBlock(policy, pairs, [&](size_t i)
+                             { mergeFunc(bounds[2 * i], bounds[2 * i + 1], bounds[2 * i + 2]); });
+                std::vector<RandomIt> next;
+                for (size_t i = 0; i < runs; i += 2)
+                {
+                    next.push_back(bounds[i]);
+                }
+                next.push_back(bounds.back());
+                bounds.swap(next);
+            }
+        }
+    }
+
+    // 并行排序：分段并行 std::sort，再两两原地合并（std::inplace_merge 在内存不足时退化为无缓冲合并）
+    template <typename RandomIt, typename Compare>
+    void sort(const ParallelPolicy &policy, RandomIt first, RandomIt last, Compare comp)
+    {
+        using T = typename std::iterator_traits<RandomIt>::value_type;
+        size_t n = last - first;
+        size_t minRun = std::max<size_t>(1, CACHE_BLOCK_BYTES / sizeof(T));
+        size_t runs = std::min<size_t>(policy.concurrency(), n / minRun);
+        if (runs <= 1)
+        {
+            std::sort(first, last, comp);
+            return;
+        }
+        std::vector<RandomIt> bounds;
+        for (size_t i = 0; i <= runs; i++)
+        {
+            bounds.push_back(first + n * i / runs);
+        }
+        detail::forEachBlock(policy, runs, [&](size_t i)
+                             { std::sort(bounds[i], bounds[i + 1], comp); });
+        detail::mergeTree(policy, bounds, [&](RandomIt lo, RandomIt mid, RandomIt hi)
+                          { std::inplace_merge(lo, mid, hi, comp); });
+    }
+
+    template <typename RandomIt>
+    void sort(const ParallelPolicy &policy, RandomIt first, RandomIt last)
+    {
+        parallel::sort(policy, first, last, std::less<>());
+    }
+
+    // 并行规约：每个分块串行变换并规约，再按分块顺序合并部分结果，reduce 需满足结合律
+    template <typename RandomIt, typename T, typename BinaryReduce, typename UnaryTransform>
+    T transform_reduce(const ParallelPolicy &policy, RandomIt first, RandomIt last, T init,
+                       BinaryReduce reduce, UnaryTransform transform)
+    {
+        size_t n = last - first;
+        size_t block = detail::blockSize<typename std::iterator_traits<RandomIt>::value_type>(policy, n);
+        size_t count = (n + block - 1) / block;
+        std::vector<std::optional<T>> partial(count);
+        detail::forEachBlock(policy, count, [&](size_t b)
+                             {
+            RandomIt it = first + b * block;
+            RandomIt end = first + std::min(n, (b + 1) * block);
+            T acc = transform(*it);
+            for (++it; it != end; ++it)
+            {
+                acc = reduce(std::move(acc), transform(*it));
+            }
+            partial[b].emplace(std::move(acc)); });
+        for (auto &value : partial)
+        {
+            init = reduce(std::move(init), std::move(*value));
+        }
+        return init;
+    }
+
+    // 并行内积：sum(first1[i] * first2[i]) + init
+    template <typename RandomIt1, typename RandomIt2, typename T>
+    T transform_reduce(const ParallelPolicy &policy, RandomIt1 first1, RandomIt1 last1, RandomIt2 first2, T init)
+    {
+        size_t n = last1 - first1;
+        size_t block = detail::blockSize<typename std::iterator_traits<RandomIt1>::value_type>(policy, n);
+        size_t count = (n + block - 1) / block;
+        std::vector<std::optional<T>> partial(count);
+        detail::forEachBlock(policy, count, [&](size_t b)
+                             {
+            size_t begin = b * block;
+            size_t end = std::min(n, begin + block);
+            partial[b].emplace(std::inner_product(first1 + begin, first1 + end, first2 + begin, T())); });
+        for (auto &value : partial)
+        {
+            init = std::move(init) + std::move(*value);
+        }
+        return init;
+    }
+
+    namespace detail
+    {
+        // 三阶段并行前缀和：并行求各分块的和，串行求分块偏移，再并行扫描各分块
+        // 支持 d_first == first 的原地扫描
+        template <typename RandomIt, typename OutputIt, typename T, typename BinaryOp>
+        OutputIt scan(const ParallelPolicy &policy, RandomIt first, RandomIt last, OutputIt d_first,
+                      std::optional<T> init, BinaryOp op, bool inclusive)
+        {
+            size_t n = last - first;
+            if (n == 0)
+                return d_first;
+            size_t block = blockSize<typename std::iterator_traits<RandomIt>::value_type>(policy, n);
+            size_t count = (n + block - 1) / block;
+            // 第一阶段：除最后一个分块外，求每个分块的和
+            std::vector<std::optional<T>> sums(count);
+            forEachBlock(policy, count - 1, [&](size_t b)
+                         {
+                RandomIt it = first + b * block;
+                RandomIt end = it + block;
+                T acc = *it;
+                for (++it; it != end; ++it)
+                {
+                    acc = op(std::move(acc), *it);
+                }
+                sums[b].emplace(std::move(acc)); });
+            // 第二阶段：串行计算每个分块的起始偏移
+            std::vector<std::optional<T>> offsets(count);
+            offsets[0] = init;
+            for (size_t b = 1; b < count; b++)
+            {
+                offsets[b].emplace(offsets[b - 1] ? op(*offsets[b - 1], *sums[b - 1]) : *sums[b - 1]);
+            }
+            // 第三阶段：各分块从偏移开始扫描
+            forEachBlock(policy, count, [&](size_t b)
+                         {
+                RandomIt it = first + b * block;
+                RandomIt end = first + std::min(n, (b + 1) * block);
+                OutputIt out = d_first + b * block;
+                std::optional<T> acc = offsets[b];
+                for (; it != end; ++it, ++out)
+                {
+                    T value = *it;
+                    if (!inclusive)
+                        *out = *acc;
+                    acc.emplace(acc ? op(std::move(*acc), std::move(value)) : std::move(value));
+                    if (inclusive)
+                        *out = *acc;
+                } });
+            return d_first + n;
+        }
+    }
+
+    template <typename RandomIt, typename OutputIt, typename BinaryOp>
+    OutputIt inclusive_scan(const ParallelPolicy &policy, RandomIt first, RandomIt last, OutputIt d_first, BinaryOp op)
+    {
+        using T = typename std::iterator_traits<RandomIt>::value_type;
+        return detail::scan<RandomIt, OutputIt, T>(policy, first, last, d_first, std::nullopt, op, true);
+    }
+
+    template <typename RandomIt, typename OutputIt>
+    OutputIt inclusive_scan(const ParallelPolicy &policy, RandomIt first, RandomIt last, OutputIt d_first)
+    {
+        return parallel::inclusive_scan(policy, first, last, d_first, std::plus<>());
+    }
+
+    template <typename RandomIt, typename OutputIt, typename T, typename BinaryOp>
+    OutputIt exclusive_scan(const ParallelPolicy &policy, RandomIt first, RandomIt last, OutputIt d_first, T init, BinaryOp op)
+    {
+        return detail::scan<RandomIt, OutputIt, T>(policy, first, last, d_first, std::optional<T>(std::move(init)), op, false);
+    }
+
+    template <typename RandomIt, typename OutputIt, typename T>
+    OutputIt exclusive_scan(const ParallelPolicy &policy, RandomIt first, RandomIt last, OutputIt d_first, T init)
+    {
+        return parallel::exclusive_scan(policy, first, last, d_first, std::move(init), std::plus<>());
+    }
+
+    // 并行分区：各分块并行 std::stable_partition，再两两旋转合并相邻分块，结果是稳定的
+    // 返回第二组的起始位置
+    template <typename RandomIt, typename UnaryPredicate>
+    RandomIt partition(const ParallelPolicy &policy, RandomIt first, RandomIt last, UnaryPredicate pred)
+    {
+        size_t n = last - first;
+        size_t block = detail::blockSize<typename std::iterator_traits<RandomIt>::value_type>(policy, n);
+        size_t count = n == 0 ? 0 : (n + block - 1) / block;
+        if (count <= 1)
+            return std::stable_partition(first, last, pred);
+        // 每个区间记录 [起始, 分界点)，合并时把左区间的第二组和右区间的第一组交换位置
+        std::vector<RandomIt> bounds(count + 1);
+        std::vector<RandomIt> mids(count);
+        for (size_t b = 0; b <= count; b++)
+        {
+            bounds[b] = first + std::min(n, b * block);
+        }
+        detail::forEachBlock(policy, count, [&](size_t b)
+                             { mids[b] = std::stable_partition(bounds[b], bounds[b + 1], pred); });
+        while (bounds.size() > 2)
+        {
+            size_t runs = bounds.size() - 1;
+            size_t pairs = runs / 2;
+            std::vector<RandomIt> nextMids((runs + 1) / 2);
+            detail::forEachBlock(policy, pairs, [&](size_t i)
+                                 { nextMids[i] = std::rotate(mids[2 * i], bounds[2 * i + 1], mids[2 * i + 1]); });
+            if (runs % 2 == 1)
+                nextMids.back() = mids.back();
+            std::vector<RandomIt> nextBounds;
+            for (size_t i = 0; i < runs; i += 2)
+            {
+                nextBounds.push_back(bounds[i]);
+            }
+            nextBounds.push_back(bounds.back());
+            bounds.swap(nextBounds);
+            mids.swap(nextMids);
+        }
+        return mids[0];
+    }
+
+    // 并行去除相邻重复元素：先并行标记保留的元素，各分块并行原地压缩，再依次前移各分块
+    // 返回新的逻辑结尾
+    template <typename RandomIt, typename BinaryPredicate>
+    RandomIt unique(const ParallelPolicy &policy, RandomIt first, RandomIt last, BinaryPredicate pred)
+    {
+        size_t n = last - first;
+        size_t block = detail::blockSize<typename std::iterator_traits<RandomIt>::value_type>(policy, n);
+        size_t count = n == 0 ? 0 : (n + block - 1) / block;
+        if (count <= 1)
+            return std::unique(first, last, pred);
+        // 第一阶段：只读地标记每个元素是否保留，分块边界处和前一个分块的最后一个元素比较
+        std::vector<char> keep(n);
+        detail::forEachBlock(policy, count, [&](size_t b)
+                             {
+            size_t end = std::min(n, (b + 1) * block);
+            for (size_t i = b * block; i < end; i++)
+            {
+                keep[i] = i == 0 || !pred(first[i - 1], first[i]);
+            } });
+        // 第二阶段：各分块把保留的元素前移到分块开头
+        std::vector<size_t> kept(count);
+        detail::forEachBlock(policy, count, [&](size_t b)
+                             {
+            size_t begin = b * block;
+            size_t end = std::min(n, begin + block);
+            size_t out = begin;
+            for (size_t i = begin; i < end; i++)
+            {
+                if (keep[i])
+                {
+                    if (out != i)
+                        first[out] = std::move(first[i]);
+                    out++;
+                }
+            }
+            kept[b] = out - begin; });
+        // 第三阶段：依次把各分块保留的元素移动到结果位置，目标位置总在源位置之前
+        RandomIt out = first + kept[0];
+        for (size_t b = 1; b < count; b++)
+        {
+            RandomIt src = first + b * block;
+            out = std::move(src, src + kept[b], out);
+        }
+        return out;
+    }
+
+    template <typename RandomIt>
+    RandomIt unique(const ParallelPolicy &policy, RandomIt first, RandomIt last)
+    {
+        return parallel::unique(policy, first, last, std::equal_to<>());
+    }
+}
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#include "threadpool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+多阶段流水线：每个阶段有独立的并行度，阶段之间使用有界无锁队列连接，
+同时在流水线中的数据项数量不超过 tokens，最慢的阶段会反压上游，内存占用有上界。
+example:
+ThreadPool pool;
+pool.start(4);
+Pipeline<std::string> pipeline(pool, 16); // 最多 16 个数据项同时在流水线中
+pipeline.stage(StageMode::PARALLEL, 4, [](std::string line) { return parse(line); })
+        .stage(StageMode::PARALLEL, 2, [](Record rec) { return compress(rec); })
+        .stage(StageMode::SERIAL_IN_ORDER, 1, [&](Block block) { out.write(block); });
+size_t count = pipeline.run([&]() -> std::optional<std::string> {
+    std::string line;
+    if (!std::getline(in, line))
+        return std::nullopt; // 返回 nullopt 表示输入结束
+    return line;
+});
+*/
+
+enum class StageMode
+{
+    SERIAL_IN_ORDER, // 串行执行，按照数据项进入流水线的顺序处理
+    PARALLEL         // 并行执行，最多 parallelism 个线程同时处理
+};
+
+// 有界多生产者多消费者无锁队列（基于每个槽位的序号），容量向上取整为 2 的幂
+template <typename T>
+class BoundedChannel
+{
+public:
+    explicit BoundedChannel(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            cells_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+    BoundedChannel(const BoundedChannel &) = delete;
+    BoundedChannel &operator=(const BoundedChannel &) = delete;
+
+    // 队列满返回 false
+    bool push(T &&data)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells_[pos & mask_];
+            size_t seq = cell.sequence_.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data_ = std::move(data);
+                    cell.sequence_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 队列空返回 false
+    bool pop(std::optional<T> &data)
+    {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells_[pos & mask_];
+            size_t seq = cell.sequence_.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    data.emplace(std::move(*cell.data_));
+                    cell.data_.reset();
+                    cell.sequence_.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 近似判断队列是否为空，只用于决定是否需要重新调度消费者
+    bool empty() const
+    {
+        return enqueuePos_.load() == dequeuePos_.load();
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence_;
+        std::optional<T> data_;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+class PipelineStageBase;
+
+// 流水线共享状态：令牌计数、运行中的阶段任务计数和阶段执行中抛出的第一个异常
+class PipelineCore
+{
+public:
+    PipelineCore(ThreadPool &pool, int tokens, size_t batchSize)
+        : pool_(pool), tokens_(tokens > 0 ? tokens : 1), batchSize_(batchSize > 0 ? batchSize : 1),
+          inFlight_(0), runningTasks_(0) {}
+
+    // 获取一个令牌，流水线中数据项已满时阻塞（反压）
+    void acquire()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [&]() -> bool
+                   { return inFlight_ < tokens_; });
+        inFlight_++;
+    }
+    // 数据项离开流水线，归还令牌
+    void release()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        inFlight_--;
+        cond_.notify_all();
+    }
+    void taskStarted()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        runningTasks_++;
+    }
+    void taskFinished()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        runningTasks_--;
+        cond_.notify_all();
+    }
+    // 等待所有数据项流出、所有阶段任务退出
+    void waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait(lock, [&]() -> bool
+                   { return inFlight_ == 0 && runningTasks_ == 0; });
+    }
+    void setError(std::exception_ptr error)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!error_)
+            error_ = error;
+    }
+    std::exception_ptr takeError()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        return error;
+    }
+
+    ThreadPool &pool_;
+    const int tokens_;
+    const size_t batchSize_;
+    std::vector<std::unique_ptr<PipelineStageBase>> stages_;
+
+private:
+    int inFlight_;     // 流水线中的数据项数量
+    int runningTasks_; // 已提交但未退出的阶段任务数量
+    std::exception_ptr error_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
+class PipelineStageBase
+{
+public:
+    PipelineStageBase(PipelineCore *core, StageMode mode, int parallelism)
+        : core_(core), mode_(mode),
+          parallelism_(mode == StageMode::SERIAL_IN_ORDER || parallelism < 1 ? 1 : parallelism), active_(0) {}
+    virtual ~PipelineStageBase() = default;
+    // 开始一次新的 run 之前重置阶段状态
+    virtual void reset() = 0;
+
+protected:
+    // 处理一批数据项，处理完成后返回
+    virtual void drain() = 0;
+    virtual bool hasInput() const = 0;
+
+    // 阶段并行度未满时提交一个阶段任务到线程池
+    void schedule()
+    {
+        // 与 runOnce 中的栅栏配对(Dekker)：数据入队(relaxed CAS)对退出的阶段任务可见之后才读取 active_，
+        // 否则弱内存序 CPU 上可能双方都看不到对方的写入，数据项滞留导致 waitIdle 一直阻塞
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int active = active_.load();
+        while (active < parallelism_)
+        {
+            if (active_.compare_exchange_weak(active, active + 1))
+            {
+                core_->taskStarted();
+                Result res = core_->pool_.trySubmitTask(core_->pool_.makeTask<StageTask>(this));
+                if (!res.isValid())
+                {
+                    // 线程池任务队列已满，不等待空余，由当前线程直接执行
+                    runOnce();
+                }
+                return;
+            }
+        }
+    }
+
+    PipelineCore *core_;
+    StageMode mode_;
+
+private:
+    class StageTask : public Task
+    {
+    public:
+        explicit StageTask(PipelineStageBase *stage) : stage_(stage) {}
+        Any run() override
+        {
+            stage_->runOnce();
+            return 0;
+        }
+
+    private:
+        PipelineStageBase *stage_;
+    };
+
+    void runOnce()
+    {
+        drain();
+        active_--;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // 退出前又有数据进入，重新调度，避免数据项滞留
+        if (hasInput())
+            schedule();
+        core_->taskFinished();
+    }
+
+    const int parallelism_;
+    std::atomic_int active_; // 正在运行的阶段任务数量
+};
+
+template <typename T>
+class PipelineInput
+{
+public:
+    virtual ~PipelineInput() = default;
+    // item 为空表示上游处理失败，只占用序号，保证串行阶段的序号连续
+    virtual void push(size_t seq, std::optional<T> &&item) = 0;
+};
+
+template <typename In, typename Out>
+class PipelineStage : public PipelineStageBase, public PipelineInput<In>
+{
+public:
+    using NextType = typename std::conditional<std::is_void<Out>::value, char, Out>::type;
+
+    PipelineStage(PipelineCore *core, StageMode mode, int parallelism, std::function<Out(In)> func)
+        : PipelineStageBase(core, mode, parallelism), next_(nullptr), func_(std::move(func)),
+          channel_(core->tokens_), nextSeq_(0) {}
+
+    void push(size_t seq, std::optional<In> &&item) override
+    {
+        std::pair<size_t, std::optional<In>> entry(seq, std::move(item));
+        // 令牌数量等于队列容量，正常情况下不会满
+        while (!channel_.push(std::move(entry)))
+        {
+            std::this_thread::yield();
+        }
+        schedule();
+    }
+
+    void reset() override
+    {
+        pending_.clear();
+        nextSeq_ = 0;
+    }
+
+    PipelineInput<NextType> *next_; // 下一个阶段，为空表示最后一个阶段
+
+protected:
+    void drain() override
+    {
+        std::optional<std::pair<size_t, std::optional<In>>> entry;
+        for (size_t n = 0; n < core_->batchSize_ && channel_.pop(entry); n++)
+        {
+            if (mode_ == StageMode::PARALLEL)
+            {
+                process(entry->first, std::move(entry->second));
+                continue;
+            }
+            // 串行阶段同一时刻只有一个任务运行，借助重排缓冲区按序号顺序处理
+            pending_.emplace(entry->first, std::move(entry->second));
+            while (!pending_.empty() && pending_.begin()->first == nextSeq_)
+            {
+                auto it = pending_.begin();
+                process(it->first, std::move(it->second));
+                pending_.erase(it);
+                nextSeq_++;
+            }
+        }
+    }
+
+    bool hasInput() const override
+    {
+        return !channel_.empty();
+    }
+
+private:
+    void process(size_t seq, std::optional<In> &&item)
+    {
+        if constexpr (std::is_void<Out>::value)
+        {
+            if (item)
+            {
+                try
+                {
+                    func_(std::move(*item));
+                }
+                catch (...)
+                {
+                    core_->setError(std::current_exception());
+                }
+            }
+        }
+        else
+        {
+            std::optional<Out> out;
+            if (item)
+            {
+                try
+                {
+                    out.emplace(func_(std::move(*item)));
+                }
+                catch (...)
+                {
+                    core_->setError(std::current_exception());
+                }
+            }
+            if (next_ != nullptr)
+            {
+                next_->push(seq, std::move(out));
+                return;
+            }
+        }
+        core_->release();
+    }
+
+    std::function<Out(In)> func_;
+    BoundedChannel<std::pair<size_t, std::optional<In>>> channel_;
+    std::map<size_t, std::optional<In>> pending_; // 串行阶段的重排缓冲区，最多 tokens 个数据项
+    size_t nextSeq_;               // 串行阶段下一个要处理的序号
+};
+
+// 流水线构建器，T 为上一个阶段的输出类型
+template <typename T>
+class PipelineBuilder
+{
+public:
+    PipelineBuilder(PipelineCore *core, PipelineInput<T> **tail) : core_(core), tail_(tail) {}
+
+    // 添加一个阶段，func 接收上一阶段的输出，返回值传给下一阶段（最后一个阶段可以返回 void）
+    template <typename Func>
+    auto stage(StageMode mode, int parallelism, Func func) -> PipelineBuilder<std::invoke_result_t<Func, T>>
+    {
+        using Out = std::invoke_result_t<Func, T>;
+        auto ptr = std::make_unique<PipelineStage<T, Out>>(core_, mode, parallelism, std::function<Out(T)>(std::move(func)));
+        PipelineStage<T, Out> *stage = ptr.get();
+        core_->stages_.emplace_back(std::move(ptr));
+        *tail_ = stage;
+        if constexpr (std::is_void<Out>::value)
+        {
+            return PipelineBuilder<void>();
+        }
+        else
+        {
+            return PipelineBuilder<Out>(core_, &stage->next_);
+        }
+    }
+
+protected:
+    PipelineCore *core_;
+    PipelineInput<T> **tail_; // 上一个阶段指向下一阶段的指针
+};
+
+// 最后一个阶段返回 void，流水线结束
+template <>
+class PipelineBuilder<void>
+{
+};
+
+// In 为输入数据项类型
+template <typename In>
+class Pipeline : public PipelineBuilder<In>
+{
+public:
+    // tokens 为同时在流水线中的数据项数量上限，batchSize 为阶段任务每次被调度处理的数据项数量上限
+    Pipeline(ThreadPool &pool, int tokens, size_t batchSize = 16)
+        : PipelineBuilder<In>(nullptr, &head_), coreOwner_(std::make_unique<PipelineCore>(pool, tokens, batchSize)), head_(nullptr)
+    {
+        this->core_ = coreOwner_.get();
+    }
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    // 从 source 拉取数据项送入流水线，source 返回 std::nullopt 表示输入结束
+    // 阻塞到所有数据项处理完毕，返回处理的数据项数量；阶段抛出的第一个异常在这里重新抛出
+    // source 抛出异常时等已送入的数据项处理完毕后重新抛出 source 的异常
+    template <typename Source>
+    size_t run(Source source)
+    {
+        if (head_ == nullptr)
+            throw std::runtime_error("pipeline has no stage");
+        PipelineCore *core = coreOwner_.get();
+        for (auto &stage : core->stages_)
+        {
+            stage->reset();
+        }
+        size_t seq = 0;
+        for (;;)
+        {
+            core->acquire();
+            std::optional<In> item;
+            try
+            {
+                item = source();
+            }
+            catch (...)
+            {
+                // 阶段任务还在线程池中引用流水线，等已送入的数据项处理完再抛出，阶段异常被丢弃
+                core->release();
+                core->waitIdle();
+                core->takeError();
+                throw;
+            }
+            if (!item)
+            {
+                core->release();
+                break;
+            }
+            head_->push(seq++, std::move(item));
+        }
+        core->waitIdle();
+        if (std::exception_ptr error = core->takeError())
+            std::rethrow_exception(error);
+        return seq;
+    }
+
+private:
+    std::unique_ptr<PipelineCore> coreOwner_;
+    PipelineInput<In> *head_; // 第一个阶段
+};
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef SHM_QUEUE_H
+#define SHM_QUEUE_H
+#include "threadpool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+/*
+跨进程共享内存任务队列（仅 Linux）：多个生产者进程提交任务，一个线程池进程执行并回写结果。
+共享内存布局：队列头 | capacity 个环形队列单元 | capacity 个任务描述符 | capacity 个数据槽（arena）
+任务描述符从无锁空闲链表分配，每个描述符固定对应 arena 中一个 slotBytes 大小的数据槽，
+保存请求数据，执行完成后原地写回结果；无锁环形队列只传递描述符下标，任务被取走时单元即释放。
+描述符在生产者 wait 取回结果后归还，一个生产者迟迟不取结果只占用它自己的描述符，不会阻塞其他生产者；
+生产者进程已退出或超过 resultTtlMs 没有取回结果时，由执行进程的 ShmTaskServer 定期回收(reclaim)。
+等待使用 futex，跨进程同步不依赖 pthread 共享锁。
+生产者在 submit 入队的过程中崩溃仍会让该环形队列位置无法被消费，需要重新创建队列。
+
+example:
+// 执行进程
+auto queue = ShmTaskQueue::create("/my_queue", 256, 4096);
+ThreadPool pool;
+pool.start(4);
+ShmTaskServer server(*queue, pool);
+server.registerHandler("echo", [](const std::string &payload) { return payload; });
+server.start();
+// 生产者进程（例如 fork 出的子进程）
+auto queue = ShmTaskQueue::open("/my_queue");
+uint64_t ticket;
+queue->submit("echo", "hello", 5, ticket);
+std::string result;
+int status = queue->wait(ticket, result);
+*/
+
+// 任务执行状态
+enum ShmTaskStatus
+{
+    SHM_TASK_OK = 0,
+    SHM_TASK_NO_HANDLER = -1,       // 没有注册对应名称的处理函数
+    SHM_TASK_RESULT_TOO_LARGE = -2, // 结果超过数据槽大小
+    SHM_TASK_EXCEPTION = -3,        // 处理函数抛出异常
+    SHM_TASK_TIMEOUT = -4,          // 等待结果超时
+    SHM_TASK_REJECTED = -5,         // 线程池拒绝或丢弃了任务（已关闭、队列满或取消排队任务）
+    SHM_TASK_EXPIRED = -6           // 结果超过保留时间没有取回，描述符已被回收
+};
+
+struct ShmQueueHeader;
+struct ShmRingCell;
+struct ShmTaskDesc;
+
+// 消费者取出的任务，payload 指向共享内存中的数据槽，complete 之前有效
+struct ShmTaskRef
+{
+    uint64_t ticket;
+    std::string handler;
+    const char *payload;
+    size_t size;
+};
+
+class ShmTaskQueue
+{
+public:
+    static const size_t HANDLER_NAME_MAX = 32;
+
+    static const uint32_t RESULT_TTL_MS = 30000;
+
+    // 创建共享内存队列，capacity（描述符数量）向上取整为 2 的幂，同名的旧队列会被重新初始化
+    // resultTtlMs 为已完成任务的结果最长保留时间，超时后 reclaim 可以回收描述符
+    static std::unique_ptr<ShmTaskQueue> create(const std::string &name, uint32_t capacity, uint32_t slotBytes,
+                                                uint32_t resultTtlMs = RESULT_TTL_MS);
+    // 打开已经创建的共享内存队列
+    static std::unique_ptr<ShmTaskQueue> open(const std::string &name);
+    // 删除共享内存对象名称，已映射的进程不受影响
+    static void unlink(const std::string &name);
+
+    ~ShmTaskQueue();
+    ShmTaskQueue(const ShmTaskQueue &) = delete;
+    ShmTaskQueue &operator=(const ShmTaskQueue &) = delete;
+
+    // 生产者提交任务，没有空闲描述符时最多等待 timeoutMs 毫秒；needResult 为 false 时执行完成后直接回收描述符
+    bool submit(const std::string &handler, const void *data, size_t size, uint64_t &ticket,
+                bool needResult = true, int timeoutMs = 1000);
+    // 生产者等待任务完成并取回结果，返回 ShmTaskStatus；每个 ticket 只能等待一次
+    // 结果已被 reclaim 回收时返回 SHM_TASK_EXPIRED，队列关闭时任务还没被取走返回 SHM_TASK_REJECTED
+    int wait(uint64_t ticket, std::string &result, int timeoutMs = -1);
+
+    // 消费者取出一个任务，队列空时最多等待 timeoutMs 毫秒
+    bool take(ShmTaskRef &ref, int timeoutMs);
+    // 消费者回写结果，唤醒等待的生产者
+    void complete(uint64_t ticket, int status, const void *data, size_t size);
+    // 回收生产者进程已退出或超过 resultTtlMs 没有取回结果的描述符，返回回收的数量
+    size_t reclaim();
+
+    // 关闭队列，唤醒所有等待的生产者和消费者；还没被取走的任务以 SHM_TASK_REJECTED 完成
+    void close();
+    bool isClosed() const;
+
+    uint32_t capacity() const;
+    uint32_t slotBytes() const;
+
+private:
+    ShmTaskQueue(int fd, void *base, size_t size);
+
+    // ticket 对应的描述符，下标越界返回 nullptr
+    ShmTaskDesc *desc(uint64_t ticket) const;
+    char *slot(const ShmTaskDesc &d) const;
+    uint32_t allocSlot();
+    void freeSlot(uint32_t index);
+
+    int fd_;
+    void *base_;
+    size_t size_;
+    ShmQueueHeader *header_;
+    ShmRingCell *ring_;
+    ShmTaskDesc *descs_;
+    char *arena_;
+};
+
+// 执行进程一侧：把共享内存队列中的任务分派到 ThreadPool 执行，并定期回收无人取回的结果
+// queue 和 pool 必须在 stop 返回之后才能销毁
+class ShmTaskServer
+{
+public:
+    using Handler = std::function<std::string(const std::string &)>;
+
+    ShmTaskServer(ShmTaskQueue &queue, ThreadPool &pool);
+    ~ShmTaskServer();
+    ShmTaskServer(const ShmTaskServer &) = delete;
+    ShmTaskServer &operator=(const ShmTaskServer &) = delete;
+
+    // 注册处理函数，需在 start 之前调用
+    void registerHandler(const std::string &name, Handler handler);
+    // 启动分派线程
+    void start();
+    // 停止分派线程，并等待已分派到线程池的任务执行完或被线程池丢弃
+    void stop();
+
+private:
+    friend class ShmTask;
+    void dispatchFunc();
+    void taskStarted();
+    void taskFinished();
+
+    ShmTaskQueue &queue_;
+    ThreadPool &pool_;
+    std::unordered_map<std::string, Handler> handlers_;
+    std::atomic_bool isRunning_;
+    std::thread dispatcher_;
+    int pendingTasks_; // 已分派还没有执行完的任务数量
+    std::mutex pendingMtx_;
+    std::condition_variable pendingCond_;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 #include <vector>
+#include <algorithm>
 #include <queue>
 #include <atomic>
 #include <memory>
@@ -10,6 +11,9 @@
 #include <iostream>
 #include <thread>
 #include <unordered_map>
+#include <string>
+#include <cstddef>
+#include <chrono>
 
 class Any
 {
@@ -88,6 +92,24 @@ private:
     std::condition_variable cond_;
 };
 
+// 任务完成状态：保存返回值和完成通知的信号量
+// 存放在 Task 对象内部，地址在任务生命周期内保持不变，Result 拷贝/移动不影响回写
+class ResultState
+{
+public:
+    ResultState() = default;
+    ResultState(const ResultState &) = delete;
+    ResultState &operator=(const ResultState &) = delete;
+    // setVal 设置任务返回值并通知等待方
+    void setVal(Any any);
+    // get 阻塞等待任务完成，取出返回值
+    Any get();
+
+private:
+    Any any_;       // 存储任务返回值
+    Semaphore sem_; // 线程通信信号量
+};
+
 // 前置声明
 class Task;
 class Result
@@ -95,16 +117,18 @@ class Result
 public:
     Result(std::shared_ptr<Task> task, bool isValid = true);
     ~Result() = default;
+    Result(Result &&) = default;
+    Result &operator=(Result &&) = default;
     // setVal 获取任务返回值
     void setVal(Any any);
     // get 方法，获取 Task的返回值
     Any get();
+    // 任务是否提交成功
+    bool isValid() const;
 
 private:
-    Any any_;                    // 存储任务返回值
-    Semaphore sem_;              // 线程通信信号量
-    std::shared_ptr<Task> task_; // 对应获取返回值的 Task 对象
-    std::atomic_bool isValid_;   // 返回值是否有效
+    std::shared_ptr<Task> task_; // 对应获取返回值的 Task 对象，持有其完成状态
+    bool isValid_;               // 返回值是否有效
 };
 
 // 任务抽象基类
@@ -112,13 +136,116 @@ private:
 class Task
 {
 public:
-    Task();
+    Task() : cancelled_(false) {}
     virtual ~Task() = default;
     void exec();
-    void setResult(Result *res);
+    // 获取任务的完成状态
+    ResultState &state();
+    // 请求取消任务：排队中的任务不再执行，运行中的任务可以在 run 中检查 isCancelled 提前返回
+    void cancel();
+    bool isCancelled() const;
     virtual Any run() = 0; // 纯虚函数
 private:
-    Result *result_; // 与任务对应的 Result 对象
+    ResultState state_;          // 与任务对应的完成状态
+    std::atomic_bool cancelled_; // 是否被请求取消
+};
+
+// 按类型分开缓存 Task 对象内存块的空闲链表
+// 由 ThreadPool 创建，分配器通过 shared_ptr 持有，保证 Result 比线程池活得久时也能安全归还
+class TaskFreeList
+{
+public:
+    TaskFreeList() = default;
+    ~TaskFreeList();
+    TaskFreeList(const TaskFreeList &) = delete;
+    TaskFreeList &operator=(const TaskFreeList &) = delete;
+
+    template <typename U>
+    void *allocate()
+    {
+        size_t slot = typeSlot<U>();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (slot < lists_.size() && !lists_[slot].empty())
+            {
+                void *p = lists_[slot].back();
+                lists_[slot].pop_back();
+                return p;
+            }
+        }
+        return ::operator new(sizeof(U));
+    }
+
+    template <typename U>
+    void deallocate(void *p)
+    {
+        size_t slot = typeSlot<U>();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (slot >= lists_.size())
+                lists_.resize(slot + 1);
+            // 每种类型最多缓存 FREE_LIST_MAX_SIZE 个内存块，超出部分直接释放
+            if (lists_[slot].size() < FREE_LIST_MAX_SIZE)
+            {
+                lists_[slot].push_back(p);
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+private:
+    // 每个类型分配一个固定的下标，避免按类型查找哈希表
+    template <typename U>
+    static size_t typeSlot()
+    {
+        static const size_t slot = nextSlot_++;
+        return slot;
+    }
+
+    static const size_t FREE_LIST_MAX_SIZE = 1024;
+    static std::atomic<size_t> nextSlot_;
+    std::mutex mtx_;
+    std::vector<std::vector<void *>> lists_;
+};
+
+// 配合 std::allocate_shared 使用的分配器，Task 对象和引用计数控制块放在同一个回收的内存块里
+template <typename T>
+class TaskAllocator
+{
+public:
+    using value_type = T;
+
+    explicit TaskAllocator(std::shared_ptr<TaskFreeList> freeList) : freeList_(std::move(freeList)) {}
+    template <typename U>
+    TaskAllocator(const TaskAllocator<U> &other) : freeList_(other.freeList_) {}
+
+    T *allocate(size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned task is not supported");
+        if (n != 1)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(freeList_->template allocate<T>());
+    }
+    void deallocate(T *p, size_t n)
+    {
+        if (n != 1)
+        {
+            ::operator delete(p);
+            return;
+        }
+        freeList_->template deallocate<T>(p);
+    }
+
+    template <typename U>
+    bool operator==(const TaskAllocator<U> &other) const { return freeList_ == other.freeList_; }
+    template <typename U>
+    bool operator!=(const TaskAllocator<U> &other) const { return freeList_ != other.freeList_; }
+
+private:
+    template <typename U>
+    friend class TaskAllocator;
+    std::shared_ptr<TaskFreeList> freeList_;
 };
 
 enum class PoolMode
@@ -127,21 +254,42 @@ enum class PoolMode
     MODE_CACHED // 线程数量可以动态增长
 };
 
+enum class ShutdownMode
+{
+    DRAIN,          // 不再接收新任务，执行完队列中的任务后退出
+    CANCEL_PENDING, // 不再接收新任务，丢弃队列中的任务，等待运行中的任务结束
+    ABORT           // 在 CANCEL_PENDING 基础上对运行中的任务调用 cancel()
+};
+
+struct ThreadState;
+// 线程对象：线程函数运行在进程级线程缓存提供的系统线程上，
+// 线程函数返回后系统线程停放在缓存中，供任意线程池的后续线程复用
 class Thread
 {
 public:
     using ThreadFunc = std::function<void(int)>;
-    Thread(ThreadFunc func);
+    // stackSize/guardSize 为 0 表示使用系统默认值
+    Thread(ThreadFunc func, size_t stackSize = 0, size_t guardSize = 0);
     ~Thread();
-    // 启动线程
+    // 启动线程，系统线程创建失败抛出 std::runtime_error
     void start();
+    // 等待线程函数结束
+    void join();
     // 获取线程 id
     int getId() const;
 
+    // 设置进程级线程缓存最多停放的系统线程数量，0 表示关闭缓存
+    static void setCacheCapacity(size_t capacity);
+    // 获取当前停放在缓存中的系统线程数量
+    static size_t getParkedThreadSize();
+
 private:
     ThreadFunc func_;
-    static int generateId_;
-    int threadId_; // 保存线程 id
+    static std::atomic_int generateId_;
+    int threadId_;                      // 保存线程 id
+    size_t stackSize_;                  // 线程栈大小
+    size_t guardSize_;                  // 线程栈保护区大小
+    std::shared_ptr<ThreadState> state_; // 线程函数是否结束，由线程池负责 join
 };
 /*
 example:
@@ -154,9 +302,23 @@ class MyTask:public Task
         //任务处理逻辑
     }
 };
-std::shared_ptr<Task> task=std::make_shared<MyTask>();
+std::shared_ptr<Task> task=pool.makeTask<MyTask>(); //从线程池的空闲链表创建任务，也可以用 std::make_shared
 pool.submitTask(task); //提交任务到线程池
 */
+// 任务分组（租户）的运行统计
+struct GroupStats
+{
+    std::string name;     // 分组名称
+    int weight;           // 调度权重
+    int maxConcurrency;   // 并发上限，0 表示不限制
+    int queMaxThreshHold; // 分组任务队列上限
+    size_t queued;        // 当前排队任务数量
+    int running;          // 当前正在执行的任务数量
+    size_t submitted;     // 累计提交成功的任务数量
+    size_t rejected;      // 累计因队列满被拒绝的任务数量
+    size_t completed;     // 累计执行完成的任务数量
+};
+
 class ThreadPool
 {
 public:
@@ -171,10 +333,42 @@ public:
     void setTaskQueMaxThreshHold(int size);
     // 设置线程池 cached 模式线程上限阈值
     void setThreadSizeMaxThreshHold(int size);
-    // 提交任务
+    // 设置线程池 cached 模式线程最大空闲时间(秒)
+    void setThreadMaxIdleTime(int seconds);
+    // 设置工作线程的栈大小和栈保护区大小(字节)，0 表示使用系统默认值
+    void setThreadStackSize(size_t stackSize, size_t guardSize = 0);
+    // 设置是否按需创建线程：开启时 start 不创建线程，提交任务时空闲线程不足才创建，最多 initThreadSize 个(cached 模式为上限阈值)
+    void setLazySpawn(bool lazy);
+    // 获取初始线程数量
+    int getInitThreadSize() const;
+    // 获取当前线程总数量
+    int getThreadSize() const;
+    // 获取当前空闲线程数量
+    int getIdleThreadSize() const;
+    // 获取当前排队的任务数量
+    int getTaskSize() const;
+    // 添加任务分组，weight 为调度权重，maxConcurrency 为并发上限(0 不限制)，
+    // queMaxThreshHold 为分组队列上限(0 表示使用 setTaskQueMaxThreshHold 的值)
+    bool addGroup(const std::string &name, int weight = 1, int maxConcurrency = 0, int queMaxThreshHold = 0);
+    // 获取分组统计信息，分组不存在返回 false
+    bool getGroupStats(const std::string &name, GroupStats &stats);
+    // 创建任务对象，内存从线程池的空闲链表分配，任务和 Result 都释放后归还复用
+    template <typename T, typename... Args>
+    std::shared_ptr<T> makeTask(Args &&...args)
+    {
+        return std::allocate_shared<T>(TaskAllocator<T>(taskFreeList_), std::forward<Args>(args)...);
+    }
+    // 提交任务到默认分组，传入右值(如 makeTask 的返回值)时任务一路移动到队列中
     Result submitTask(std::shared_ptr<Task> sp);
-    // 启动线程池
+    // 提交任务到指定分组
+    Result submitTask(std::shared_ptr<Task> sp, const std::string &group);
+    // 提交任务到默认分组，任务队列已满时不等待，立即返回无效的 Result
+    Result trySubmitTask(std::shared_ptr<Task> sp);
+    // 启动线程池，shutdown 成功后可以再次启动
     void start(int initThreadSize = std::thread::hardware_concurrency());
+    // 关闭线程池并 join 所有线程，timeoutMs < 0 表示一直等待
+    // 超时返回 false，剩余线程在运行中的任务结束后退出，再次调用 shutdown 或析构时 join
+    bool shutdown(ShutdownMode mode = ShutdownMode::DRAIN, int timeoutMs = -1);
 
     ThreadPool(const ThreadPool &) = delete;
     ThreadPool &operator=(const ThreadPool &) = delete;
@@ -185,18 +379,68 @@ private:
 
     // 检查 pool 的运行状态
     bool checkRunningState() const;
+    // 创建并启动一个线程，需持有 taskQueMtx_，系统线程创建失败返回 false
+    bool createThread();
+
+    struct TaskGroup;
+    // 把任务提交到下标为 index 的分组，任务队列已满时最多等待 timeout，需持有 taskQueMtx_
+    Result submitTask(std::shared_ptr<Task> &&sp, size_t index, std::unique_lock<std::mutex> &lock,
+                      std::chrono::milliseconds timeout);
+    // 按加权轮转(DRR)选出下一个可调度的分组，没有则返回 nullptr，需持有 taskQueMtx_
+    TaskGroup *pickGroup();
+    // 不受并发上限限制、空闲线程可以立即执行的排队任务数量，需持有 taskQueMtx_
+    size_t dispatchableTaskSize() const;
 
 private:
+    // 任务分组：每个分组拥有独立的任务队列、权重、并发上限和队列上限
+    struct TaskGroup
+    {
+        std::string name_;
+        int weight_;
+        int maxConcurrency_;
+        int queMaxThreshHold_;
+        int deficit_; // 本轮剩余可调度的任务数量
+        int running_;
+        size_t submitted_;
+        size_t rejected_;
+        size_t completed_;
+        std::queue<std::shared_ptr<Task>> taskQue_;
+
+        // 分组有任务且未达到并发上限
+        bool dispatchable() const
+        {
+            return !taskQue_.empty() && (maxConcurrency_ <= 0 || running_ < maxConcurrency_);
+        }
+
+        // 排队任务中还能再开始执行的数量
+        size_t dispatchableSize() const
+        {
+            if (maxConcurrency_ <= 0)
+                return taskQue_.size();
+            size_t quota = running_ < maxConcurrency_ ? maxConcurrency_ - running_ : 0;
+            return std::min(taskQue_.size(), quota);
+        }
+    };
+
+
     // std::vector<std::unique_ptr<Thread>> threads_; //任务队列
     std::unordered_map<int, std::unique_ptr<Thread>> threads_; // 任务队列
+    std::vector<std::unique_ptr<Thread>> exitedThreads_;       // 已退出等待 join 的线程
+    std::unordered_map<int, Task *> runningTasks_;             // 各线程正在执行的任务
     size_t initThreadSize_;                                    // 初始线程数量
     std::atomic_int curThreadSize_;                            // 线程池当前线程总数量
     int threadSizeThreshHold_;                                 // 线程数量上限值
+    int threadMaxIdleTime_;                                    // cached 模式线程最大空闲时间(秒)
+    size_t threadStackSize_;                                   // 工作线程栈大小
+    size_t threadGuardSize_;                                   // 工作线程栈保护区大小
+    bool lazySpawn_;                                           // 是否按需创建线程
     std::atomic_int idleThreadSize_;                           // 空闲线程的数量
 
-    std::queue<std::shared_ptr<Task>> taskQueue_; // 任务队列
-    std::atomic_int taskSize_;                    // 任务数量
-    int taskQueMaxThreshHold_;                    // 任务队列最大容量
+    std::vector<std::unique_ptr<TaskGroup>> groups_;     // 任务分组，下标 0 为默认分组
+    std::unordered_map<std::string, size_t> groupIndex_; // 分组名称到下标的映射
+    size_t rrIndex_;                                     // 轮转调度当前所在的分组
+    std::atomic_int taskSize_;                           // 任务数量
+    int taskQueMaxThreshHold_;                           // 任务队列最大容量
 
     std::mutex taskQueMtx_;            // 任务队列互斥锁
     std::condition_variable notFull_;  // 任务队列不为满条件变量
@@ -205,6 +449,8 @@ private:
 
     PoolMode poolMode_;              // 线程池模式
     std::atomic_bool isPoolRunning_; // 线程池是否开始运行
+
+    std::shared_ptr<TaskFreeList> taskFreeList_; // Task 对象内存的空闲链表
 };
 
 #endif
\ No newline at end of file
@@ -11,10 +11,43 @@
 #include <thread>
 #include <unordered_map>
 #include <future>
+#include <typeindex>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
 
 const int TASK_MAX_THRESHHOLD = 1024;
 const int THREAD_MAX_THRESHHOLD = 100;
 const int THREAD_MAX_IDLE_TIME = 60;
+const int PROFILE_MIN_SAMPLES = 16;      // 估计值至少基于多少次执行，才会据此内联或合并
+const long long INLINE_MAX_NS = 1000;    // 估计耗时低于该值的任务直接在提交线程执行
+const long long COALESCE_MAX_NS = 20000; // 估计耗时低于该值的任务合并到同一个队列项
+const int COALESCE_BATCH_SIZE = 64;      // 一个合并队列项最多包含的任务数量
+
+// 按调用点统计的耗时估计
+struct CallableProfile
+{
+    std::string name;     // 调用点标签，没有标签时为可调用对象的类型名，函数指针附带函数地址
+    long long samples;    // 执行次数
+    long long estimateNs; // 指数加权平均耗时(纳秒)
+    long long inlined;    // 在提交线程直接执行的次数
+    long long coalesced;  // 被合并进已有队列项的次数
+};
+
+// 耗时统计的调用点标签：同一个可调用对象在不同调用点耗时差别很大时，用标签分开统计
+// pool.submitTask(ProfileTag("parse"), parse, line);
+struct ProfileTag
+{
+    ProfileTag() = default;
+    explicit ProfileTag(std::string name) : name(std::move(name)) {}
+    std::string name;
+};
 
 enum class PoolMode
 {
@@ -22,6 +55,13 @@ enum class PoolMode
     MODE_CACHED // 线程数量可以动态增长
 };
 
+enum class ShutdownMode
+{
+    DRAIN,          // 不再接收新任务，执行完队列中的任务后退出
+    CANCEL_PENDING, // 不再接收新任务，丢弃队列中的任务，等待运行中的任务结束
+    ABORT           // 简化版的任务无法取消，等同于 CANCEL_PENDING
+};
+
 class Thread
 {
 public:
@@ -34,9 +74,14 @@ public:
     // 启动线程
     void start()
     {
-        // 创建一个线程来执行一个函数
-        std::thread t(func_, threadId_);
-        t.detach();
+        // 创建一个线程来执行一个函数，线程由线程池负责 join
+        thread_ = std::thread(func_, threadId_);
+    }
+    // 等待线程函数返回，不能在线程函数内部调用
+    void join()
+    {
+        if (thread_.joinable())
+            thread_.join();
     }
     // 获取线程 id
     int getId() const
@@ -46,11 +91,12 @@ public:
 
 private:
     ThreadFunc func_;
-    static int generateId_;
+    static std::atomic_int generateId_;
     int threadId_; // 保存线程 id
+    std::thread thread_;
 };
 
-int Thread::generateId_ = 0;
+std::atomic_int Thread::generateId_(0);
 
 class ThreadPool
 {
@@ -63,17 +109,65 @@ public:
           isPoolRunning_(false),
           idleThreadSize_(0),
           curThreadSize_(0),
-          threadSizeThreshHold_(THREAD_MAX_THRESHHOLD)
+          threadSizeThreshHold_(THREAD_MAX_THRESHHOLD),
+          isProfiling_(false),
+          inlineMaxNs_(INLINE_MAX_NS),
+          coalesceMaxNs_(COALESCE_MAX_NS),
+          profileId_(nextProfileId())
     {
     }
     ~ThreadPool()
     {
-        isPoolRunning_ = false;
-        // 等待所有线程退出
-        std::unique_lock<std::mutex> lock(taskQueMtx_);
-        notEmpty_.notify_all(); // 唤醒所有线程，让其退出
-        exitCond_.wait(lock, [&]() -> bool
-                       { return curThreadSize_ == 0; });
+        shutdown(ShutdownMode::DRAIN);
+    }
+
+    // 关闭线程池并 join 所有线程，timeoutMs < 0 表示一直等待
+    // 超时返回 false，剩余线程在运行中的任务结束后退出，再次调用 shutdown 或析构时 join
+    // 被丢弃的任务，其 future::get 抛出 std::future_error(broken_promise)
+    bool shutdown(ShutdownMode mode = ShutdownMode::DRAIN, int timeoutMs = -1)
+    {
+        std::vector<std::unique_ptr<Thread>> joinThreads;
+        {
+            std::unique_lock<std::mutex> lock(taskQueMtx_);
+            // 在锁内修改运行状态，避免线程检查状态之后、等待之前错过通知
+            isPoolRunning_ = false;
+            if (mode != ShutdownMode::DRAIN)
+            {
+                taskQueue_ = std::queue<Task>();
+                openBatch_.reset();
+                taskSize_ = 0;
+            }
+            notEmpty_.notify_all(); // 唤醒所有线程，让其退出
+            notFull_.notify_all();  // 唤醒等待队列空余的提交者，让其失败返回
+
+            auto exited = [&]() -> bool
+            { return curThreadSize_ == 0; };
+            if (timeoutMs < 0)
+            {
+                exitCond_.wait(lock, exited);
+            }
+            else if (!exitCond_.wait_for(lock, std::chrono::milliseconds(timeoutMs), exited))
+            {
+                return false;
+            }
+            // 所有线程函数都已返回，取出线程对象在锁外 join
+            for (auto &thread : threads_)
+            {
+                joinThreads.emplace_back(std::move(thread.second));
+            }
+            threads_.clear();
+            for (auto &thread : exitedThreads_)
+            {
+                joinThreads.emplace_back(std::move(thread));
+            }
+            exitedThreads_.clear();
+            idleThreadSize_ = 0;
+        }
+        for (auto &thread : joinThreads)
+        {
+            thread->join();
+        }
+        return true;
     }
 
     // 设置线程池模式
@@ -107,22 +201,79 @@ public:
             threadSizeThreshHold_ = size;
         }
     }
+    // 开启/关闭按可调用对象类型的耗时统计，开启后很便宜的任务会被内联执行或合并入队
+    void setProfiling(bool enable)
+    {
+        isProfiling_ = enable;
+    }
+    // 设置内联执行和合并入队的耗时阈值(纳秒)，设为 0 关闭对应优化
+    void setCostThreshold(long long inlineNs, long long coalesceNs)
+    {
+        inlineMaxNs_ = inlineNs;
+        coalesceMaxNs_ = coalesceNs;
+    }
+    // 导出各可调用对象类型的耗时估计，按估计耗时从小到大排列，靠前的调用点粒度过细
+    std::vector<CallableProfile> getProfile()
+    {
+        std::vector<CallableProfile> profile;
+        std::lock_guard<std::mutex> lock(profileMtx_);
+        for (auto &entry : profiles_)
+        {
+            const CallableStats &stats = *entry.second;
+            profile.push_back({stats.name_, stats.samples_, stats.estimateNs_, stats.inlined_, stats.coalesced_});
+        }
+        std::sort(profile.begin(), profile.end(), [](const CallableProfile &a, const CallableProfile &b)
+                  { return a.estimateNs < b.estimateNs; });
+        return profile;
+    }
+
     // 提交任务,使用可变参模板编程，可以接受任意任务函数和任意数量的参数
     // Result submitTask(std::shared_ptr<Task> sp);
     template <typename Func, typename... Args>
     auto submitTask(Func &&func, Args &&...args) -> std::future<decltype(func(args...))>
+    {
+        return submitTask(ProfileTag(), std::forward<Func>(func), std::forward<Args>(args)...);
+    }
+    // 提交任务，耗时按 tag 标识的调用点单独统计
+    template <typename Func, typename... Args>
+    auto submitTask(const ProfileTag &tag, Func &&func, Args &&...args) -> std::future<decltype(func(args...))>
     {
         using RType = decltype(func(args...));
         auto task = std::make_shared<std::packaged_task<RType()>>(
             std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
         std::future<RType> result = task->get_future();
+
+        // 开启统计时，按可调用对象类型查找耗时估计，足够便宜的任务直接在当前线程执行
+        CallableStats *stats = nullptr;
+        long long estimateNs = 0;
+        if (isProfiling_)
+        {
+            // 函数指针按地址区分，同签名的不同函数不共用估计值
+            using FType = typename std::decay<Func>::type;
+            const void *address = functionAddress<typename std::remove_reference<Func>::type>(func);
+            if (tag.name.empty())
+                stats = cachedProfileOf<FType>(address);
+            else
+                stats = profileOf({typeid(FType), address, tag.name});
+            if (stats->samples_ >= PROFILE_MIN_SAMPLES)
+                estimateNs = stats->estimateNs_;
+            if (stats->samples_ >= PROFILE_MIN_SAMPLES && estimateNs < inlineMaxNs_)
+            {
+                stats->inlined_++;
+                stats->run([task]()
+                           { (*task)(); });
+                return result;
+            }
+        }
+
         // 获取锁
         std::unique_lock<std::mutex> lock(taskQueMtx_);
         // 线程通信，等待任务队列有空余
         if (!notFull_.wait_for(lock, std::chrono::seconds(1), [&]() -> bool
-                               { return taskQueue_.size() < (size_t)taskQueMaxThreshHold_; }))
+                               { return !isPoolRunning_ || taskQueue_.size() < (size_t)taskQueMaxThreshHold_; }) ||
+            !isPoolRunning_)
         {
-            // 等待 1 秒还是没满足
+            // 等待 1 秒还是没满足，或者线程池没有运行
             std::cerr << "taskQue is full, submit task fail" << std::endl;
             auto task0 = std::make_shared<std::packaged_task<RType()>>(
                 []() -> RType
@@ -133,7 +284,39 @@ public:
         // 如果有空，把任务放入任务队列
         // using Task = std::function<void()>;
         // std::queue<Task> taskQueue_;
-        taskQueue_.emplace([task](){(*task)();});
+        if (stats == nullptr)
+        {
+            taskQueue_.emplace([task](){(*task)();});
+            openBatch_.reset();
+        }
+        else if (stats->samples_ >= PROFILE_MIN_SAMPLES && estimateNs < coalesceMaxNs_)
+        {
+            Task entry = [task, stats]()
+            { stats->run([&]()
+                         { (*task)(); }); };
+            // 队尾是还没被取走的合并项，直接追加进去，不新增队列项
+            if (openBatch_ != nullptr && openBatch_->size() < (size_t)COALESCE_BATCH_SIZE)
+            {
+                openBatch_->emplace_back(std::move(entry));
+                stats->coalesced_++;
+                return result;
+            }
+            openBatch_ = std::make_shared<std::vector<Task>>();
+            openBatch_->emplace_back(std::move(entry));
+            taskQueue_.emplace([batch = openBatch_]()
+                               {
+                for (auto &t : *batch)
+                {
+                    t();
+                } });
+        }
+        else
+        {
+            taskQueue_.emplace([task, stats]()
+                               { stats->run([&]()
+                                            { (*task)(); }); });
+            openBatch_.reset();
+        }
 
         taskSize_++;
         // 放入队列，队列不空，在 notEmpty_通知
@@ -143,6 +326,12 @@ public:
         if (poolMode_ == PoolMode::MODE_CACHED && taskSize_ > idleThreadSize_ && curThreadSize_ < threadSizeThreshHold_)
         {
             std::cout << "create new thread" << std::endl;
+            // 回收之前因空闲超时退出的线程
+            for (auto &thread : exitedThreads_)
+            {
+                thread->join();
+            }
+            exitedThreads_.clear();
             // 创建一个线程对象，并启动
             auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
             int threadId = ptr->getId();
@@ -156,24 +345,30 @@ public:
     // 启动线程池
     void start(int initThreadSize = std::thread::hardware_concurrency())
     {
+        std::unique_lock<std::mutex> lock(taskQueMtx_);
+        // 已经启动，或者上一次 shutdown 超时还有线程没有退出
+        if (isPoolRunning_ || curThreadSize_ > 0)
+            return;
         // 设置线程池运行状态
         isPoolRunning_ = true;
         // 记录初始线程个数
         initThreadSize_ = initThreadSize;
         curThreadSize_ = initThreadSize;
 
-        // 创建线程对象
+        // 创建线程对象，线程 id 是全局递增的，记录新建的线程对象，不能按下标访问 threads_
+        std::vector<Thread *> created;
         for (int i = 0; i < initThreadSize_; i++)
         {
             auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
             int threadId = ptr->getId();
+            created.push_back(ptr.get());
             threads_.emplace(threadId, std::move(ptr));
         }
 
         // 启动所有线程
-        for (int i = 0; i < initThreadSize_; i++)
+        for (Thread *thread : created)
         {
-            threads_[i]->start();
+            thread->start();
             idleThreadSize_++;
         }
     }
@@ -188,15 +383,6 @@ private:
         auto lastTime = std::chrono::high_resolution_clock::now();
         for (;;)
         {
-            if (!isPoolRunning_)
-                {
-                    threads_.erase(threadId);
-                    curThreadSize_--;
-                    idleThreadSize_--;
-                    exitCond_.notify_all();
-                    std::cout << "threadid=" << std::this_thread::get_id() << " exit" << std::endl;
-                    return;// 线程函数结束，线程退出
-                }
             Task task;
             {
                 std::unique_lock<std::mutex> lock(taskQueMtx_);
@@ -219,7 +405,8 @@ private:
                             {
                                 // 开始回收当前线程
                                 // 记录线程数量的相关变量的值修改
-                                // 把线程对象从线程列表容器里面删除
+                                // 把线程对象从线程列表移到待 join 列表，线程不能 join 自己
+                                exitedThreads_.emplace_back(std::move(threads_[threadId]));
                                 threads_.erase(threadId);
                                 curThreadSize_--;
                                 idleThreadSize_--;
@@ -234,10 +421,14 @@ private:
                     }
                     
                 }
-                // 线程池被关闭，线程退出
-                if (!isPoolRunning_)
+                // 线程池被关闭且任务全部取走，线程退出，线程对象留给 shutdown join
+                if (taskQueue_.size() == 0)
                 {
-                    break;
+                    curThreadSize_--;
+                    idleThreadSize_--;
+                    exitCond_.notify_all();
+                    std::cout << "threadid=" << std::this_thread::get_id() << " exit" << std::endl;
+                    return; // 线程函数结束，线程退出
                 }
 
                 idleThreadSize_--;
@@ -246,6 +437,11 @@ private:
 
                 task = taskQueue_.front();
                 taskQueue_.pop();
+                // 合并项被取走后不能再追加任务
+                if (taskQueue_.empty())
+                {
+                    openBatch_.reset();
+                }
                 taskSize_--;
                 // 有剩余任务，通知其他线程
                 if (taskQueue_.size() > 0)
@@ -273,18 +469,142 @@ private:
         return isPoolRunning_;
     }
 
+    // 统计的键：可调用对象类型 + 函数地址(仅函数指针) + 调用点标签
+    struct ProfileKey
+    {
+        std::type_index type;
+        const void *address;
+        std::string tag;
+
+        bool operator==(const ProfileKey &other) const
+        {
+            return type == other.type && address == other.address && tag == other.tag;
+        }
+    };
+    struct ProfileKeyHash
+    {
+        size_t operator()(const ProfileKey &key) const
+        {
+            size_t h = key.type.hash_code() ^ (std::hash<const void *>()(key.address) * 31);
+            return key.tag.empty() ? h : h ^ (std::hash<std::string>()(key.tag) * 131);
+        }
+    };
+
+    // 函数指针和函数引用返回函数地址，其他可调用对象返回 nullptr（按类型区分即可）
+    template <typename F>
+    static const void *functionAddress(const F &func)
+    {
+        if constexpr (std::is_pointer<F>::value && std::is_function<typename std::remove_pointer<F>::type>::value)
+            return reinterpret_cast<const void *>(func);
+        else if constexpr (std::is_function<F>::value)
+            return reinterpret_cast<const void *>(&func);
+        else
+            return nullptr;
+    }
+
+    // 导出用的可读名称：有标签用标签，否则用反解后的类型名，函数指针附带地址
+    static std::string profileName(const ProfileKey &key)
+    {
+        if (!key.tag.empty())
+            return key.tag;
+        std::string name = key.type.name();
+#ifdef __GNUG__
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+        if (status == 0 && demangled != nullptr)
+            name = demangled;
+        std::free(demangled);
+#endif
+        if (key.address != nullptr)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), " @%p", key.address);
+            name += buf;
+        }
+        return name;
+    }
+
+    // 单个调用点的统计数据，节点地址稳定，任务直接持有指针更新
+    struct CallableStats
+    {
+        std::string name_;
+        std::atomic<long long> samples_{0};
+        std::atomic<long long> estimateNs_{0};
+        std::atomic<long long> inlined_{0};
+        std::atomic<long long> coalesced_{0};
+
+        // 执行并记录耗时，估计值按 1/8 的权重指数加权平均
+        template <typename F>
+        void run(F &&func)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            func();
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - begin)
+                               .count();
+            long long old = estimateNs_.load();
+            long long now = samples_.fetch_add(1) == 0 ? ns : old + (ns - old) / 8;
+            while (!estimateNs_.compare_exchange_weak(old, now))
+            {
+                now = old + (ns - old) / 8;
+            }
+        }
+    };
+
+    CallableStats *profileOf(ProfileKey &&key)
+    {
+        std::lock_guard<std::mutex> lock(profileMtx_);
+        auto it = profiles_.find(key);
+        if (it == profiles_.end())
+        {
+            auto stats = std::make_unique<CallableStats>();
+            stats->name_ = profileName(key);
+            it = profiles_.emplace(std::move(key), std::move(stats)).first;
+        }
+        return it->second.get();
+    }
+
+    // 没有标签的调用点：每个线程按可调用对象类型缓存最近一次查到的统计项，命中时不构造键、不加锁
+    // 缓存按线程池编号区分，线程池销毁后同一地址上的新线程池不会命中旧的统计项
+    template <typename F>
+    CallableStats *cachedProfileOf(const void *address)
+    {
+        struct CacheEntry
+        {
+            unsigned long long poolId = 0;
+            const void *address = nullptr;
+            CallableStats *stats = nullptr;
+        };
+        thread_local CacheEntry cache;
+        if (cache.poolId != profileId_ || cache.address != address)
+        {
+            cache.stats = profileOf({typeid(F), address, std::string()});
+            cache.poolId = profileId_;
+            cache.address = address;
+        }
+        return cache.stats;
+    }
+
+    static unsigned long long nextProfileId()
+    {
+        static std::atomic<unsigned long long> next(0);
+        return ++next;
+    }
+
 private:
     // std::vector<std::unique_ptr<Thread>> threads_; //任务队列
     std::unordered_map<int, std::unique_ptr<Thread>> threads_; // 任务队列
+    std::vector<std::unique_ptr<Thread>> exitedThreads_;       // 已退出等待 join 的线程
     size_t initThreadSize_;                                    // 初始线程数量
     std::atomic_int curThreadSize_;                            // 线程池当前线程总数量
     int threadSizeThreshHold_;                                 // 线程数量上限值
     std::atomic_int idleThreadSize_;                           // 空闲线程的数量
 
     using Task = std::function<void()>;
-    std::queue<Task> taskQueue_; // 任务队列
-    std::atomic_int taskSize_;   // 任务数量
-    int taskQueMaxThreshHold_;   // 任务队列最大容量
+    std::queue<Task> taskQueue_;                   // 任务队列
+    std::shared_ptr<std::vector<Task>> openBatch_; // 队尾还可以追加任务的合并项
+    std::atomic_int taskSize_;                     // 任务数量
+    int taskQueMaxThreshHold_;                     // 任务队列最大容量
 
     std::mutex taskQueMtx_;            // 任务队列互斥锁
     std::condition_variable notFull_;  // 任务队列不为空条件变量
@@ -293,6 +613,13 @@ private:
 
     PoolMode poolMode_;              // 线程池模式
     std::atomic_bool isPoolRunning_; // 线程池是否开始运行
+
+    std::atomic_bool isProfiling_;                                                // 是否开启耗时统计
+    std::atomic<long long> inlineMaxNs_;                                          // 内联执行的耗时阈值
+    std::atomic<long long> coalesceMaxNs_;                                        // 合并入队的耗时阈值
+    std::mutex profileMtx_;                                                       // 统计表互斥锁
+    std::unordered_map<ProfileKey, std::unique_ptr<CallableStats>, ProfileKeyHash> profiles_; // 按调用点的耗时统计
+    const unsigned long long profileId_;                                          // 线程池编号，区分各线程的统计项缓存
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "../include/threadpool.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+工作线程内存占用和创建延迟基准（仅 Linux）：对比优化前后两种线程配置
+    before: 启动时创建全部线程 + 系统默认栈大小 + 关闭线程缓存
+    after : 按需创建线程 + 256KB 栈 + 进程级线程缓存
+每种配置在独立的子进程中运行，互不影响：
+    footprint: 同时存在 POOL_NUM 个线程池，每个 start(THREAD_NUM) 后只提交少量任务，读取 /proc/self/status
+    spawn    : 反复 创建线程池 -> start -> 执行一个任务 -> 析构，统计每轮平均耗时
+
+用法：
+    ThreadPool_bench [--pools 32] [--threads 8] [--cycles 500]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+const size_t SMALL_STACK_SIZE = 256 * 1024;
+
+struct BenchConfig
+{
+    const char *name;
+    bool lazySpawn;
+    size_t stackSize;
+    size_t cacheCapacity;
+};
+
+class EchoTask : public Task
+{
+public:
+    EchoTask(int val) : val_(val) {}
+    Any run() { return val_; }
+
+private:
+    int val_;
+};
+
+// 读取 /proc/self/status 中的一项，单位为 kB（Threads 为个数）
+static long readStatus(const std::string &key)
+{
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, key.size() + 1, key + ":") == 0)
+            return std::stol(line.substr(key.size() + 1));
+    }
+    return -1;
+}
+
+static void applyConfig(ThreadPool &pool, const BenchConfig &config)
+{
+    pool.setMode(PoolMode::MODE_CACHED);
+    pool.setLazySpawn(config.lazySpawn);
+    pool.setThreadStackSize(config.stackSize);
+}
+
+static void runFootprint(const BenchConfig &config, int poolNum, int threadNum)
+{
+    long rssBefore = readStatus("VmRSS");
+    long vszBefore = readStatus("VmSize");
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    auto begin = Clock::now();
+    for (int i = 0; i < poolNum; i++)
+    {
+        auto pool = std::make_unique<ThreadPool>();
+        applyConfig(*pool, config);
+        pool->start(threadNum);
+        // 轻负载：每个线程池只有两个任务
+        Result r1 = pool->submitTask(pool->makeTask<EchoTask>(i));
+        Result r2 = pool->submitTask(pool->makeTask<EchoTask>(i));
+        r1.get().cast_<int>();
+        r2.get().cast_<int>();
+        pools.push_back(std::move(pool));
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    std::cerr << std::left << std::setw(8) << config.name << "footprint: pools=" << poolNum
+              << " threads=" << readStatus("Threads")
+              << " VmRSS+=" << readStatus("VmRSS") - rssBefore << "kB"
+              << " VmSize+=" << readStatus("VmSize") - vszBefore << "kB"
+              << " setup=" << std::fixed << std::setprecision(2) << ms << "ms" << std::endl;
+}
+
+static void runSpawn(const BenchConfig &config, int threadNum, int cycles)
+{
+    auto begin = Clock::now();
+    for (int i = 0; i < cycles; i++)
+    {
+        ThreadPool pool;
+        applyConfig(pool, config);
+        pool.start(threadNum);
+        pool.submitTask(pool.makeTask<EchoTask>(i)).get().cast_<int>();
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - begin).count() / cycles;
+    std::cerr << std::left << std::setw(8) << config.name << "spawn    : cycles=" << cycles
+              << " avg=" << std::fixed << std::setprecision(2) << us << "us/cycle"
+              << " parked=" << Thread::getParkedThreadSize() << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    int poolNum = 32;
+    int threadNum = 8;
+    int cycles = 500;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--pools")
+            poolNum = std::stoi(argv[i + 1]);
+        else if (arg == "--threads")
+            threadNum = std::stoi(argv[i + 1]);
+        else if (arg == "--cycles")
+            cycles = std::stoi(argv[i + 1]);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--pools 32] [--threads 8] [--cycles 500]" << std::endl;
+            return 1;
+        }
+    }
+
+    const BenchConfig configs[] = {
+        {"before", false, 0, 0},
+        {"after", true, SMALL_STACK_SIZE, 64},
+    };
+
+    // 丢弃线程池日志
+    std::cout.rdbuf(nullptr);
+    int failed = 0;
+    for (const BenchConfig &config : configs)
+    {
+        // 两个场景各自在新的子进程中运行，保证内存和线程缓存从零开始
+        for (int scenario = 0; scenario < 2; scenario++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                Thread::setCacheCapacity(config.cacheCapacity);
+                if (scenario == 0)
+                    runFootprint(config, poolNum, threadNum);
+                else
+                    runSpawn(config, threadNum, cycles);
+                _exit(0);
+            }
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -38,12 +38,12 @@ int main()
         ThreadPool pool;
         pool.setMode(PoolMode::MODE_CACHED);
         pool.start(2); // 启动线程池，指定初始线程数量为4
-        Result res1 = pool.submitTask(std::make_shared<MyTask>(1, 100000000));
-        Result res2 = pool.submitTask(std::make_shared<MyTask>(100000001, 200000000));
-        Result res3 = pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
-        pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
-        pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
-        pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
+        Result res1 = pool.submitTask(pool.makeTask<MyTask>(1, 100000000));
+        Result res2 = pool.submitTask(pool.makeTask<MyTask>(100000001, 200000000));
+        Result res3 = pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
+        pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
+        pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
+        pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
         uLong sum1 = res1.get().cast_<ulong>();
         std::cout << "Total sum is " << sum1 << std::endl;
    }
@@ -54,12 +54,12 @@ int main()
         ThreadPool pool;
         pool.setMode(PoolMode::MODE_CACHED);
         pool.start(4);
-        Result res1 = pool.submitTask(std::make_shared<MyTask>(1, 100000000));
-        Result res2 = pool.submitTask(std::make_shared<MyTask>(100000001, 200000000));
-        Result res3 = pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
-        pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
-        pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
-        pool.submitTask(std::make_shared<MyTask>(200000001, 300000000));
+        Result res1 = pool.submitTask(pool.makeTask<MyTask>(1, 100000000));
+        Result res2 = pool.submitTask(pool.makeTask<MyTask>(100000001, 200000000));
+        Result res3 = pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
+        pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
+        pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
+        pool.submitTask(pool.makeTask<MyTask>(200000001, 300000000));
 
         ulong sum1 = res1.get().cast_<ulong>();
         ulong sum2 = res2.get().cast_<ulong>();
@@ -0,0 +1,91 @@
+#include "../include/shm_queue.h"
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+多个生产者进程通过共享内存队列向同一个线程池进程提交任务
+父进程创建队列后 fork 出 PRODUCER_NUM 个子进程，子进程提交 sum 任务并校验结果，父进程负责执行
+*/
+const char *QUEUE_NAME = "/tini_thread_pool_demo";
+const int PRODUCER_NUM = 4;
+const int TASK_PER_PRODUCER = 1000;
+
+static int producerMain(int id)
+{
+    auto queue = ShmTaskQueue::open(QUEUE_NAME);
+    if (queue == nullptr)
+        return 1;
+    int failed = 0;
+    for (int i = 0; i < TASK_PER_PRODUCER; i++)
+    {
+        std::string payload = std::to_string(id) + " " + std::to_string(i);
+        uint64_t ticket;
+        if (!queue->submit("sum", payload.data(), payload.size(), ticket))
+        {
+            failed++;
+            continue;
+        }
+        std::string result;
+        if (queue->wait(ticket, result) != SHM_TASK_OK || std::stoi(result) != id + i)
+        {
+            failed++;
+        }
+    }
+    // 提交一个没有注册的处理函数，验证错误状态能够传回
+    uint64_t ticket;
+    std::string result;
+    if (!queue->submit("missing", "", 0, ticket) || queue->wait(ticket, result) != SHM_TASK_NO_HANDLER)
+    {
+        failed++;
+    }
+    std::cerr << "producer " << id << " pid=" << getpid() << " failed=" << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+int main()
+{
+    auto queue = ShmTaskQueue::create(QUEUE_NAME, 64, 256);
+    if (queue == nullptr)
+        return 1;
+
+    // 先 fork 再启动线程池，子进程中不能有父进程的工作线程
+    std::vector<pid_t> children;
+    for (int i = 0; i < PRODUCER_NUM; i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            _exit(producerMain(i));
+        }
+        children.push_back(pid);
+    }
+
+    int failed = 0;
+    {
+        ThreadPool pool;
+        pool.start(4);
+        ShmTaskServer server(*queue, pool);
+        server.registerHandler("sum", [](const std::string &payload) -> std::string
+                               {
+            size_t pos = payload.find(' ');
+            int a = std::stoi(payload.substr(0, pos));
+            int b = std::stoi(payload.substr(pos + 1));
+            return std::to_string(a + b); });
+        server.start();
+
+        for (pid_t pid : children)
+        {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        }
+        server.stop();
+    }
+    queue->close();
+    ShmTaskQueue::unlink(QUEUE_NAME);
+    std::cerr << "producers failed=" << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
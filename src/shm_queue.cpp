@@ -0,0 +1,692 @@
+#include "../include/shm_queue.h"
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <signal.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+//////////共享内存布局
+// 队列头 | capacity 个环形队列单元 | capacity 个任务描述符 | capacity 个数据槽（arena）
+// 环形队列单元只保存描述符下标，任务被 take 取走时单元立即释放；描述符从空闲链表分配，
+// 取回结果（或不需要结果的任务执行完）后归还，一个生产者迟迟不取结果只占用它自己的描述符
+// 描述符的 state 按 generation * 4 + 阶段 编码，generation 每次分配递增，ticket = generation << 32 | 下标
+// 阶段：0 空闲/正在写入，1 已提交，2 执行中（或正在取回结果），3 已完成
+const uint32_t SHM_QUEUE_MAGIC = 0x54504d53; // "TPMS"，布局变化时修改
+const uint64_t SLOT_FREE = 0;
+const uint64_t SLOT_READY = 1;
+const uint64_t SLOT_RUNNING = 2;
+const uint64_t SLOT_DONE = 3;
+const uint32_t SLOT_NIL = UINT32_MAX; // 空闲链表结束
+const uint32_t FLAG_NEED_RESULT = 1;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm queue needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm queue needs lock-free 32-bit atomics");
+
+struct ShmQueueHeader
+{
+    uint32_t magic;
+    uint32_t capacity;
+    uint32_t slotBytes;
+    uint32_t resultTtlMs; // 已完成任务的结果最长保留时间
+    std::atomic<uint32_t> closed;
+    alignas(64) std::atomic<uint64_t> enqueuePos;
+    alignas(64) std::atomic<uint64_t> dequeuePos;
+    alignas(64) std::atomic<uint64_t> freeHead; // 空闲描述符链表头：高 32 位为 ABA 计数，低 32 位为下标
+    alignas(64) std::atomic<uint32_t> notEmpty; // futex：有新任务时递增
+    std::atomic<uint32_t> consumerWaiters;
+    std::atomic<uint32_t> notFull; // futex：有描述符归还时递增
+    std::atomic<uint32_t> producerWaiters;
+};
+
+// 环形队列单元（Vyukov 有界队列）
+struct ShmRingCell
+{
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint32_t> index; // 描述符下标
+};
+
+struct ShmTaskDesc
+{
+    std::atomic<uint64_t> state;    // generation * 4 + 阶段
+    std::atomic<uint32_t> nextFree; // 空闲链表中的下一个描述符
+    std::atomic<uint32_t> done;     // futex：任务完成时递增
+    std::atomic<uint32_t> waiters;
+    uint32_t flags;
+    int32_t status;
+    uint32_t payloadSize;
+    uint32_t resultSize;
+    uint64_t payloadOffset; // 数据槽在 arena 中的偏移
+    int32_t ownerPid;       // 提交任务的生产者进程
+    uint64_t doneMs;        // 任务完成时间(CLOCK_MONOTONIC 毫秒，各进程一致)
+    char handler[ShmTaskQueue::HANDLER_NAME_MAX];
+};
+
+static size_t ringOffset()
+{
+    return (sizeof(ShmQueueHeader) + 63) & ~size_t(63);
+}
+
+static size_t descOffset(uint32_t capacity)
+{
+    return (ringOffset() + capacity * sizeof(ShmRingCell) + 63) & ~size_t(63);
+}
+
+static size_t arenaOffset(uint32_t capacity)
+{
+    return (descOffset(capacity) + capacity * sizeof(ShmTaskDesc) + 63) & ~size_t(63);
+}
+
+static uint64_t makeTicket(uint64_t generation, uint32_t index)
+{
+    return generation << 32 | index;
+}
+
+// 跨进程 futex，不能使用 FUTEX_PRIVATE_FLAG
+static void futexWait(std::atomic<uint32_t> *addr, uint32_t val, int timeoutMs)
+{
+    struct timespec ts;
+    struct timespec *pts = nullptr;
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+        pts = &ts;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT, val, pts, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t> *addr, int count)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+static uint64_t monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 进程是否存在，没有权限发送信号(EPERM)也说明进程存在
+static bool processAlive(int32_t pid)
+{
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// 计算剩余等待时间，timeoutMs < 0 表示一直等待
+static int remainingMs(std::chrono::steady_clock::time_point deadline, int timeoutMs)
+{
+    if (timeoutMs < 0)
+        return -1;
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    return left > 0 ? (int)left : 0;
+}
+
+//////////ShmTaskQueue 方法实现
+ShmTaskQueue::ShmTaskQueue(int fd, void *base, size_t size)
+    : fd_(fd),
+      base_(base),
+      size_(size),
+      header_(static_cast<ShmQueueHeader *>(base)),
+      ring_(reinterpret_cast<ShmRingCell *>(static_cast<char *>(base) + ringOffset())),
+      descs_(reinterpret_cast<ShmTaskDesc *>(static_cast<char *>(base) + descOffset(header_->capacity))),
+      arena_(static_cast<char *>(base) + arenaOffset(header_->capacity))
+{
+}
+
+ShmTaskQueue::~ShmTaskQueue()
+{
+    munmap(base_, size_);
+    ::close(fd_);
+}
+
+std::unique_ptr<ShmTaskQueue> ShmTaskQueue::create(const std::string &name, uint32_t capacity, uint32_t slotBytes,
+                                                   uint32_t resultTtlMs)
+{
+    uint32_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    capacity = size;
+    size_t total = arenaOffset(capacity) + (size_t)capacity * slotBytes;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open " << name << " fail: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // 先截断为 0 再扩展，保证旧内容被清零
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, total) != 0)
+    {
+        std::cerr << "ftruncate " << name << " fail: " << strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    void *base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "mmap " << name << " fail: " << strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+
+    ShmQueueHeader *header = new (base) ShmQueueHeader();
+    header->capacity = capacity;
+    header->slotBytes = slotBytes;
+    header->resultTtlMs = resultTtlMs;
+    header->closed.store(0);
+    header->enqueuePos.store(0);
+    header->dequeuePos.store(0);
+    header->freeHead.store(0); // 描述符 0 为链表头
+    header->notEmpty.store(0);
+    header->consumerWaiters.store(0);
+    header->notFull.store(0);
+    header->producerWaiters.store(0);
+    ShmRingCell *ring = reinterpret_cast<ShmRingCell *>(static_cast<char *>(base) + ringOffset());
+    ShmTaskDesc *descs = reinterpret_cast<ShmTaskDesc *>(static_cast<char *>(base) + descOffset(capacity));
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        ShmRingCell *cell = new (&ring[i]) ShmRingCell();
+        cell->sequence.store(i);
+        cell->index.store(SLOT_NIL);
+        ShmTaskDesc *desc = new (&descs[i]) ShmTaskDesc();
+        desc->state.store(SLOT_FREE);
+        desc->nextFree.store(i + 1 < capacity ? i + 1 : SLOT_NIL);
+        desc->done.store(0);
+        desc->waiters.store(0);
+        desc->payloadOffset = (uint64_t)i * slotBytes;
+    }
+    // magic 最后写入，open 看到 magic 说明队列已初始化完成
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_QUEUE_MAGIC;
+    return std::unique_ptr<ShmTaskQueue>(new ShmTaskQueue(fd, base, total));
+}
+
+std::unique_ptr<ShmTaskQueue> ShmTaskQueue::open(const std::string &name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open " << name << " fail: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmQueueHeader))
+    {
+        std::cerr << "shm queue " << name << " is not initialized" << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    void *base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        std::cerr << "mmap " << name << " fail: " << strerror(errno) << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    ShmQueueHeader *header = static_cast<ShmQueueHeader *>(base);
+    if (header->magic != SHM_QUEUE_MAGIC ||
+        arenaOffset(header->capacity) + (size_t)header->capacity * header->slotBytes > (size_t)st.st_size)
+    {
+        std::cerr << "shm queue " << name << " is not initialized" << std::endl;
+        munmap(base, st.st_size);
+        ::close(fd);
+        return nullptr;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return std::unique_ptr<ShmTaskQueue>(new ShmTaskQueue(fd, base, st.st_size));
+}
+
+void ShmTaskQueue::unlink(const std::string &name)
+{
+    shm_unlink(name.c_str());
+}
+
+ShmTaskDesc *ShmTaskQueue::desc(uint64_t ticket) const
+{
+    uint32_t index = (uint32_t)ticket;
+    return index < header_->capacity ? &descs_[index] : nullptr;
+}
+
+char *ShmTaskQueue::slot(const ShmTaskDesc &d) const
+{
+    return arena_ + d.payloadOffset;
+}
+
+uint32_t ShmTaskQueue::capacity() const
+{
+    return header_->capacity;
+}
+
+uint32_t ShmTaskQueue::slotBytes() const
+{
+    return header_->slotBytes;
+}
+
+// 从空闲链表取一个描述符，没有空闲描述符返回 SLOT_NIL
+uint32_t ShmTaskQueue::allocSlot()
+{
+    uint64_t head = header_->freeHead.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint32_t index = (uint32_t)head;
+        if (index == SLOT_NIL)
+            return SLOT_NIL;
+        uint32_t next = descs_[index].nextFree.load(std::memory_order_relaxed);
+        uint64_t newHead = ((head >> 32) + 1) << 32 | next;
+        if (header_->freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel))
+            return index;
+    }
+}
+
+// 把描述符归还空闲链表，唤醒等待描述符的生产者
+void ShmTaskQueue::freeSlot(uint32_t index)
+{
+    uint64_t head = header_->freeHead.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        descs_[index].nextFree.store((uint32_t)head, std::memory_order_relaxed);
+        uint64_t newHead = ((head >> 32) + 1) << 32 | index;
+        if (header_->freeHead.compare_exchange_weak(head, newHead, std::memory_order_release))
+            break;
+    }
+    header_->notFull++;
+    if (header_->producerWaiters.load() > 0)
+        futexWake(&header_->notFull, INT_MAX);
+}
+
+bool ShmTaskQueue::submit(const std::string &handler, const void *data, size_t size, uint64_t &ticket,
+                          bool needResult, int timeoutMs)
+{
+    if (handler.size() >= HANDLER_NAME_MAX || size > header_->slotBytes)
+    {
+        std::cerr << "shm task handler name or payload too large, submit task fail" << std::endl;
+        return false;
+    }
+    // 分配描述符，没有空闲描述符时等待 notFull
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    uint32_t index;
+    for (;;)
+    {
+        if (header_->closed.load())
+            return false;
+        uint32_t notFull = header_->notFull.load();
+        index = allocSlot();
+        if (index != SLOT_NIL)
+            break;
+        int left = remainingMs(deadline, timeoutMs);
+        if (left == 0)
+        {
+            std::cerr << "shm taskQue is full, submit task fail" << std::endl;
+            return false;
+        }
+        header_->producerWaiters++;
+        futexWait(&header_->notFull, notFull, left);
+        header_->producerWaiters--;
+    }
+
+    ShmTaskDesc &d = descs_[index];
+    // generation 只保留 32 位，和 ticket 中的一致
+    uint64_t generation = ((d.state.load(std::memory_order_relaxed) >> 2) + 1) & UINT32_MAX;
+    d.state.store(generation << 2 | SLOT_FREE, std::memory_order_relaxed);
+    std::memcpy(d.handler, handler.c_str(), handler.size() + 1);
+    std::memcpy(slot(d), data, size);
+    d.payloadSize = (uint32_t)size;
+    d.resultSize = 0;
+    d.status = SHM_TASK_OK;
+    d.flags = needResult ? FLAG_NEED_RESULT : 0;
+    d.ownerPid = getpid();
+    d.state.store(generation << 2 | SLOT_READY, std::memory_order_release);
+
+    // 描述符下标入队；环形队列单元和描述符数量相同，入队不会失败
+    uint64_t pos = header_->enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        ShmRingCell &cell = ring_[pos & (header_->capacity - 1)];
+        uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0)
+        {
+            if (header_->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.index.store(index, std::memory_order_relaxed);
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        }
+        else
+        {
+            // 单元还没被消费者释放（消费者刚取出下标），重新读取位置
+            pos = header_->enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    header_->notEmpty++;
+    if (header_->consumerWaiters.load() > 0)
+        futexWake(&header_->notEmpty, 1);
+    ticket = makeTicket(generation, index);
+    return true;
+}
+
+int ShmTaskQueue::wait(uint64_t ticket, std::string &result, int timeoutMs)
+{
+    ShmTaskDesc *pd = desc(ticket);
+    if (pd == nullptr)
+        return SHM_TASK_EXPIRED;
+    ShmTaskDesc &d = *pd;
+    uint64_t generation = ticket >> 32;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;)
+    {
+        uint32_t done = d.done.load();
+        uint64_t state = d.state.load(std::memory_order_acquire);
+        // 与 reclaim 竞争：先把描述符从已完成改为执行中，成功的一方负责归还
+        if (state == (generation << 2 | SLOT_DONE) &&
+            d.state.compare_exchange_strong(state, generation << 2 | SLOT_RUNNING, std::memory_order_acquire))
+            break;
+        // 描述符已被回收（可能已经分配给其他任务）
+        if (state >> 2 != generation || state == (generation << 2 | SLOT_FREE))
+            return SHM_TASK_EXPIRED;
+        if (state == (generation << 2 | SLOT_DONE))
+            continue;
+        // 队列已关闭，任务没有被取走也不会再被执行
+        if (state == (generation << 2 | SLOT_READY) && header_->closed.load())
+            return SHM_TASK_REJECTED;
+        int left = remainingMs(deadline, timeoutMs);
+        if (left == 0)
+            return SHM_TASK_TIMEOUT;
+        d.waiters++;
+        futexWait(&d.done, done, left);
+        d.waiters--;
+    }
+    int status = d.status;
+    result.assign(slot(d), d.resultSize);
+    // 取回结果后归还描述符
+    d.state.store(generation << 2 | SLOT_FREE, std::memory_order_release);
+    freeSlot((uint32_t)ticket);
+    return status;
+}
+
+size_t ShmTaskQueue::reclaim()
+{
+    size_t reclaimed = 0;
+    uint64_t now = monotonicMs();
+    for (uint32_t i = 0; i < header_->capacity; i++)
+    {
+        ShmTaskDesc &d = descs_[i];
+        uint64_t state = d.state.load(std::memory_order_acquire);
+        if ((state & 3) != SLOT_DONE)
+            continue;
+        if (now - d.doneMs < header_->resultTtlMs && processAlive(d.ownerPid))
+            continue;
+        // 与生产者的 wait 竞争，CAS 成功才归还
+        if (d.state.compare_exchange_strong(state, (state & ~uint64_t(3)) | SLOT_FREE, std::memory_order_acq_rel))
+        {
+            freeSlot(i);
+            reclaimed++;
+        }
+    }
+    return reclaimed;
+}
+
+bool ShmTaskQueue::take(ShmTaskRef &ref, int timeoutMs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    uint64_t pos = header_->dequeuePos.load(std::memory_order_relaxed);
+    uint32_t index;
+    for (;;)
+    {
+        ShmRingCell &cell = ring_[pos & (header_->capacity - 1)];
+        uint64_t seq = cell.sequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)seq - (int64_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (header_->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                // 取出下标后立即释放单元，供下一圈入队
+                index = cell.index.load(std::memory_order_relaxed);
+                cell.sequence.store(pos + header_->capacity, std::memory_order_release);
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // 队列为空，等待 notEmpty
+            uint32_t notEmpty = header_->notEmpty.load();
+            if (cell.sequence.load(std::memory_order_acquire) != seq)
+                continue;
+            int left = remainingMs(deadline, timeoutMs);
+            if (left == 0 || header_->closed.load())
+                return false;
+            header_->consumerWaiters++;
+            futexWait(&header_->notEmpty, notEmpty, left);
+            header_->consumerWaiters--;
+            pos = header_->dequeuePos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = header_->dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    ShmTaskDesc &d = descs_[index];
+    uint64_t generation = d.state.load(std::memory_order_acquire) >> 2;
+    d.state.store(generation << 2 | SLOT_RUNNING, std::memory_order_relaxed);
+    ref.ticket = makeTicket(generation, index);
+    ref.handler.assign(d.handler, strnlen(d.handler, HANDLER_NAME_MAX));
+    ref.payload = slot(d);
+    ref.size = d.payloadSize;
+    return true;
+}
+
+void ShmTaskQueue::complete(uint64_t ticket, int status, const void *data, size_t size)
+{
+    ShmTaskDesc *pd = desc(ticket);
+    if (pd == nullptr)
+        return;
+    ShmTaskDesc &d = *pd;
+    uint64_t generation = ticket >> 32;
+    if (status == SHM_TASK_OK && size > header_->slotBytes)
+    {
+        status = SHM_TASK_RESULT_TOO_LARGE;
+    }
+    if (status == SHM_TASK_OK)
+    {
+        std::memcpy(slot(d), data, size);
+        d.resultSize = (uint32_t)size;
+    }
+    d.status = status;
+    if (d.flags & FLAG_NEED_RESULT)
+    {
+        d.doneMs = monotonicMs();
+        d.state.store(generation << 2 | SLOT_DONE, std::memory_order_release);
+        d.done++;
+        if (d.waiters.load() > 0)
+            futexWake(&d.done, INT_MAX);
+        return;
+    }
+    // 生产者不需要结果，直接归还描述符
+    d.state.store(generation << 2 | SLOT_FREE, std::memory_order_release);
+    freeSlot((uint32_t)ticket);
+}
+
+void ShmTaskQueue::close()
+{
+    header_->closed.store(1);
+    header_->notEmpty++;
+    futexWake(&header_->notEmpty, INT_MAX);
+    header_->notFull++;
+    futexWake(&header_->notFull, INT_MAX);
+    // 还没被取走的任务不会再被执行，回写 SHM_TASK_REJECTED
+    ShmTaskRef ref;
+    while (take(ref, 0))
+    {
+        complete(ref.ticket, SHM_TASK_REJECTED, nullptr, 0);
+    }
+    // 唤醒所有等待结果的生产者，让其重新检查关闭状态（关闭前后并发提交的任务）
+    for (uint32_t i = 0; i < header_->capacity; i++)
+    {
+        ShmTaskDesc &d = descs_[i];
+        d.done++;
+        if (d.waiters.load() > 0)
+            futexWake(&d.done, INT_MAX);
+    }
+}
+
+bool ShmTaskQueue::isClosed() const
+{
+    return header_->closed.load() != 0;
+}
+
+//////////ShmTaskServer 方法实现
+const int SUBMIT_RETRY_MAX = 3;        // 提交到线程池的最大尝试次数
+const int SUBMIT_RETRY_BACKOFF_MS = 10; // 重试间隔，每次翻倍
+const int RECLAIM_INTERVAL_MS = 100;    // 回收无人取回结果的描述符的间隔
+
+// 在线程池中执行一个共享内存任务，并把结果写回共享内存
+// 任务没有执行就被销毁（线程池拒绝或丢弃排队任务）时回写 SHM_TASK_REJECTED，生产者不会一直等待
+class ShmTask : public Task
+{
+public:
+    ShmTask(ShmTaskServer &server, const ShmTaskServer::Handler *handler, const ShmTaskRef &ref)
+        : server_(server), queue_(server.queue_), handler_(handler), ref_(ref), ran_(false)
+    {
+        server_.taskStarted();
+    }
+
+    ~ShmTask()
+    {
+        if (!ran_)
+            queue_.complete(ref_.ticket, SHM_TASK_REJECTED, nullptr, 0);
+        // 最后访问 server_，之后 stop 可能返回
+        server_.taskFinished();
+    }
+
+    Any run() override
+    {
+        ran_ = true;
+        if (handler_ == nullptr)
+        {
+            queue_.complete(ref_.ticket, SHM_TASK_NO_HANDLER, nullptr, 0);
+            return SHM_TASK_NO_HANDLER;
+        }
+        std::string result;
+        try
+        {
+            result = (*handler_)(std::string(ref_.payload, ref_.size));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "shm task " << ref_.handler << " throw: " << e.what() << std::endl;
+            queue_.complete(ref_.ticket, SHM_TASK_EXCEPTION, nullptr, 0);
+            return SHM_TASK_EXCEPTION;
+        }
+        queue_.complete(ref_.ticket, SHM_TASK_OK, result.data(), result.size());
+        return SHM_TASK_OK;
+    }
+
+private:
+    ShmTaskServer &server_;
+    ShmTaskQueue &queue_;
+    const ShmTaskServer::Handler *handler_;
+    ShmTaskRef ref_;
+    bool ran_;
+};
+
+ShmTaskServer::ShmTaskServer(ShmTaskQueue &queue, ThreadPool &pool)
+    : queue_(queue),
+      pool_(pool),
+      isRunning_(false),
+      pendingTasks_(0)
+{
+}
+
+ShmTaskServer::~ShmTaskServer()
+{
+    stop();
+}
+
+void ShmTaskServer::registerHandler(const std::string &name, Handler handler)
+{
+    if (isRunning_)
+        return;
+    handlers_[name] = std::move(handler);
+}
+
+void ShmTaskServer::start()
+{
+    if (isRunning_)
+        return;
+    isRunning_ = true;
+    dispatcher_ = std::thread(&ShmTaskServer::dispatchFunc, this);
+}
+
+void ShmTaskServer::stop()
+{
+    isRunning_ = false;
+    if (dispatcher_.joinable())
+        dispatcher_.join();
+    // 已分派的任务引用了 queue_ 和 handlers_，等待它们执行完或被线程池丢弃
+    std::unique_lock<std::mutex> lock(pendingMtx_);
+    pendingCond_.wait(lock, [&]() -> bool
+                      { return pendingTasks_ == 0; });
+}
+
+void ShmTaskServer::taskStarted()
+{
+    std::unique_lock<std::mutex> lock(pendingMtx_);
+    pendingTasks_++;
+}
+
+void ShmTaskServer::taskFinished()
+{
+    std::unique_lock<std::mutex> lock(pendingMtx_);
+    if (--pendingTasks_ == 0)
+        pendingCond_.notify_all();
+}
+
+// 分派线程：从共享内存队列取任务，提交到线程池执行
+void ShmTaskServer::dispatchFunc()
+{
+    ShmTaskRef ref;
+    auto lastReclaim = std::chrono::steady_clock::now();
+    while (isRunning_)
+    {
+        // 定期回收生产者已退出或超时没有取回的结果，避免环形队列被占满
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReclaim >= std::chrono::milliseconds(RECLAIM_INTERVAL_MS))
+        {
+            queue_.reclaim();
+            lastReclaim = now;
+        }
+        // 定期超时返回，检查 isRunning_
+        if (!queue_.take(ref, RECLAIM_INTERVAL_MS))
+            continue;
+        auto it = handlers_.find(ref.handler);
+        const Handler *handler = it == handlers_.end() ? nullptr : &it->second;
+        std::shared_ptr<Task> task = pool_.makeTask<ShmTask>(*this, handler, ref);
+        // 线程池任务队列满时退避重试；线程池已关闭、分派线程停止或重试次数用完则放弃，
+        // 任务对象随 task 释放，析构时回写 SHM_TASK_REJECTED
+        int backoffMs = SUBMIT_RETRY_BACKOFF_MS;
+        for (int retry = 1; !pool_.submitTask(task).isValid(); retry++)
+        {
+            if (!isRunning_ || retry >= SUBMIT_RETRY_MAX)
+            {
+                std::cerr << "shm task " << ref.handler << " rejected by thread pool" << std::endl;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+            backoffMs *= 2;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+#include <iostream>
+#include <string>
+
+/*
+示例程序共用的检查函数：线程池会向 std::cout 打印日志，检查结果输出到 std::cerr
+main 最后返回 checkResult()，任一检查失败返回 1
+*/
+
+inline int &checkFailures()
+{
+    static int failed = 0;
+    return failed;
+}
+
+// 检查失败时输出名称并计数
+inline void check(bool ok, const std::string &name)
+{
+    if (!ok)
+    {
+        std::cerr << "[fail] " << name << std::endl;
+        checkFailures()++;
+    }
+}
+
+// 输出汇总结果，返回进程退出码
+inline int checkResult()
+{
+    std::cerr << (checkFailures() == 0 ? "all passed" : "some checks failed") << std::endl;
+    return checkFailures() == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include "parallel_algorithm.h"
+#include "test_check.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+并行算法示例：对不同规模的随机数据执行各个并行算法，和 std 算法的结果对比，
+并在线程池任务内部嵌套调用，验证调用线程参与计算时不会死锁
+*/
+
+static void checkAll(parallel::ParallelPolicy policy, const std::vector<int> &v)
+{
+    std::string n = " n=" + std::to_string(v.size());
+
+    std::vector<int> a = v, b = v;
+    parallel::sort(policy, a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    check(a == b, "sort" + n);
+
+    std::vector<long> o1(v.size()), o2(v.size());
+    parallel::inclusive_scan(policy, v.begin(), v.end(), o1.begin());
+    std::inclusive_scan(v.begin(), v.end(), o2.begin(), std::plus<>(), 0L);
+    check(o1 == o2, "inclusive_scan" + n);
+
+    parallel::exclusive_scan(policy, v.begin(), v.end(), o1.begin(), 5L);
+    std::exclusive_scan(v.begin(), v.end(), o2.begin(), 5L);
+    check(o1 == o2, "exclusive_scan" + n);
+
+    long r1 = parallel::transform_reduce(policy, v.begin(), v.end(), 3L, std::plus<>(), [](int x)
+                                         { return (long)x * 2; });
+    long r2 = std::transform_reduce(v.begin(), v.end(), 3L, std::plus<>(), [](int x)
+                                    { return (long)x * 2; });
+    check(r1 == r2, "transform_reduce" + n);
+
+    long d1 = parallel::transform_reduce(policy, v.begin(), v.end(), v.begin(), 0L);
+    long d2 = std::inner_product(v.begin(), v.end(), v.begin(), 0L);
+    check(d1 == d2, "transform_reduce(inner product)" + n);
+
+    auto pred = [](int x)
+    { return x % 3 == 0; };
+    a = v;
+    b = v;
+    auto am = parallel::partition(policy, a.begin(), a.end(), pred);
+    auto bm = std::stable_partition(b.begin(), b.end(), pred);
+    check(a == b && am - a.begin() == bm - b.begin(), "partition" + n);
+
+    a = v;
+    for (int &x : a)
+    {
+        x %= 4;
+    }
+    b = a;
+    auto ae = parallel::unique(policy, a.begin(), a.end());
+    auto be = std::unique(b.begin(), b.end());
+    check(ae - a.begin() == be - b.begin() && std::equal(a.begin(), ae, b.begin()), "unique" + n);
+}
+
+class NestedTask : public Task
+{
+public:
+    NestedTask(ThreadPool &pool, std::vector<int> data) : pool_(pool), data_(std::move(data)) {}
+    Any run() override
+    {
+        parallel::sort(parallel::par_on(pool_), data_.begin(), data_.end());
+        return std::is_sorted(data_.begin(), data_.end());
+    }
+
+private:
+    ThreadPool &pool_;
+    std::vector<int> data_;
+};
+
+int main()
+{
+    ThreadPool pool;
+    pool.start(4);
+
+    std::mt19937 rng(1);
+    for (size_t n : {0, 1, 5, 1000, 20000, 300007})
+    {
+        std::vector<int> v(n);
+        for (int &x : v)
+        {
+            x = rng() % 1000;
+        }
+        checkAll(parallel::par_on(pool), v);
+        checkAll(parallel::par_on(pool, 3), v);
+    }
+
+    // 多个池内任务同时嵌套调用并行算法
+    std::vector<int> big(200000);
+    for (int &x : big)
+    {
+        x = rng();
+    }
+    std::vector<Result> results;
+    for (int i = 0; i < 4; i++)
+    {
+        results.push_back(pool.submitTask(pool.makeTask<NestedTask>(pool, big)));
+    }
+    for (Result &res : results)
+    {
+        check(res.get().cast_<bool>(), "sort nested in a pool task");
+    }
+
+    return checkResult();
+}
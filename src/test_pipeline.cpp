@@ -0,0 +1,153 @@
+#include "pipeline.h"
+#include "test_check.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+流水线示例：三级流水线（并行 -> 并行 -> 串行有序），校验输出顺序、令牌限制在途数量和异常传播
+*/
+
+// 没有默认构造函数的中间类型
+struct Item
+{
+    explicit Item(int val) : val_(val) {}
+    int val_;
+};
+
+int main()
+{
+    ThreadPool pool;
+    pool.start(4);
+
+    // 多级流水线，串行阶段按输入顺序输出，重复运行验证 reset
+    {
+        const int tokens = 8;
+        std::atomic_int live(0);
+        std::atomic_int peak(0);
+        std::vector<int> out;
+        Pipeline<int> pipeline(pool, tokens, 4);
+        pipeline.stage(StageMode::PARALLEL, 4, [&](int x)
+                       {
+                    int cur = ++live;
+                    int old = peak.load();
+                    while (cur > old && !peak.compare_exchange_weak(old, cur))
+                        ;
+                    std::this_thread::sleep_for(std::chrono::microseconds(50 * (x % 7)));
+                    return Item(x); })
+            .stage(StageMode::PARALLEL, 2, [](Item item)
+                   { return std::to_string(item.val_); })
+            .stage(StageMode::SERIAL_IN_ORDER, 1, [&](std::string s)
+                   {
+                    out.push_back(std::stoi(s));
+                    live--; });
+        for (int round = 0; round < 2; round++)
+        {
+            out.clear();
+            int next = 0;
+            size_t n = pipeline.run([&]() -> std::optional<int>
+                                    {
+                if (next >= 1000)
+                    return std::nullopt;
+                return next++; });
+            bool ordered = out.size() == 1000;
+            for (size_t i = 0; ordered && i < out.size(); i++)
+            {
+                ordered = out[i] == (int)i;
+            }
+            check(n == 1000 && ordered, "pipeline round " + std::to_string(round) + " keeps input order");
+        }
+        check(peak <= tokens, "pipeline in-flight items bounded by tokens");
+    }
+
+    // 中间阶段抛出异常：run 重新抛出，后续串行阶段仍按顺序收到其余数据项
+    {
+        std::vector<int> out;
+        Pipeline<int> pipeline(pool, 4);
+        pipeline.stage(StageMode::PARALLEL, 3, [](int x)
+                       {
+                    if (x % 10 == 3)
+                        throw std::runtime_error("bad item");
+                    return x; })
+            .stage(StageMode::SERIAL_IN_ORDER, 1, [&](int x)
+                   { out.push_back(x); });
+        int next = 0;
+        bool caught = false;
+        try
+        {
+            pipeline.run([&]() -> std::optional<int>
+                         {
+                if (next >= 100)
+                    return std::nullopt;
+                return next++; });
+        }
+        catch (const std::runtime_error &)
+        {
+            caught = true;
+        }
+        check(caught && std::is_sorted(out.begin(), out.end()), "pipeline rethrows stage exception");
+    }
+
+    // source 抛出异常：已送入的数据项处理完后 run 才重新抛出，流水线对象随后可以安全销毁
+    {
+        std::atomic_int processed(0);
+        bool caught = false;
+        {
+            Pipeline<int> pipeline(pool, 4);
+            pipeline.stage(StageMode::PARALLEL, 2, [](int x)
+                           {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                        return x; })
+                .stage(StageMode::SERIAL_IN_ORDER, 1, [&](int)
+                       { processed++; });
+            int next = 0;
+            try
+            {
+                pipeline.run([&]() -> std::optional<int>
+                             {
+                    if (next >= 6)
+                        throw std::runtime_error("source failed");
+                    return next++; });
+            }
+            catch (const std::runtime_error &)
+            {
+                caught = true;
+            }
+        }
+        check(caught && processed == 6, "pipeline drains in-flight items when source throws");
+    }
+
+    // 在线程池任务内部运行流水线
+    {
+        class NestedTask : public Task
+        {
+        public:
+            explicit NestedTask(ThreadPool &pool) : pool_(pool) {}
+            Any run() override
+            {
+                long long sum = 0;
+                Pipeline<int> pipeline(pool_, 4);
+                pipeline.stage(StageMode::PARALLEL, 2, [](int x)
+                               { return x * 2; })
+                    .stage(StageMode::SERIAL_IN_ORDER, 1, [&](int x)
+                           { sum += x; });
+                int next = 0;
+                pipeline.run([&]() -> std::optional<int>
+                             {
+                    if (next >= 100)
+                        return std::nullopt;
+                    return next++; });
+                return sum;
+            }
+
+        private:
+            ThreadPool &pool_;
+        };
+        Result res = pool.submitTask(pool.makeTask<NestedTask>(pool));
+        check(res.get().cast_<long long>() == 9900, "pipeline nested in a pool task");
+    }
+
+    return checkResult();
+}
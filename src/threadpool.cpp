@@ -2,11 +2,17 @@
 #include <functional>
 #include <thread>
 #include <iostream>
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <pthread.h>
 
 //////////线程池方法实现
 const int TASK_MAX_THRESHHOLD = 1024;
 const int THREAD_MAX_THRESHHOLD = 100;
 const int THREAD_MAX_IDLE_TIME = 60;
+const size_t THREAD_CACHE_CAPACITY = 64; // 进程级线程缓存默认最多停放的系统线程数量
+const int THREAD_CACHE_IDLE_TIME = 30;   // 停放的系统线程空闲超过该时间(秒)后退出
 
 ThreadPool::ThreadPool()
     : initThreadSize_(0),
@@ -16,18 +22,84 @@ ThreadPool::ThreadPool()
       isPoolRunning_(false),
       idleThreadSize_(0),
       curThreadSize_(0),
-      threadSizeThreshHold_(THREAD_MAX_THRESHHOLD)
+      threadSizeThreshHold_(THREAD_MAX_THRESHHOLD),
+      threadMaxIdleTime_(THREAD_MAX_IDLE_TIME),
+      threadStackSize_(0),
+      threadGuardSize_(0),
+      lazySpawn_(true),
+      rrIndex_(0),
+      taskFreeList_(std::make_shared<TaskFreeList>())
 {
+    // 默认分组，未指定分组的任务都提交到这里
+    addGroup("default");
 }
 
 ThreadPool::~ThreadPool()
 {
-    isPoolRunning_ = false;
-    // 等待所有线程退出
-    std::unique_lock<std::mutex> lock(taskQueMtx_);
-    notEmpty_.notify_all(); // 唤醒所有线程，让其退出
-    exitCond_.wait(lock, [&]() -> bool
-                   { return curThreadSize_ == 0; });
+    shutdown(ShutdownMode::DRAIN);
+}
+
+bool ThreadPool::shutdown(ShutdownMode mode, int timeoutMs)
+{
+    std::vector<std::unique_ptr<Thread>> joinThreads;
+    {
+        std::unique_lock<std::mutex> lock(taskQueMtx_);
+        // 在锁内修改运行状态，避免线程检查状态之后、等待之前错过通知
+        isPoolRunning_ = false;
+        if (mode != ShutdownMode::DRAIN)
+        {
+            // 丢弃排队中的任务，Result::get 得到空的返回值
+            for (auto &group : groups_)
+            {
+                while (!group->taskQue_.empty())
+                {
+                    std::shared_ptr<Task> task = std::move(group->taskQue_.front());
+                    group->taskQue_.pop();
+                    taskSize_--;
+                    task->cancel();
+                    task->state().setVal(Any());
+                }
+            }
+        }
+        if (mode == ShutdownMode::ABORT)
+        {
+            for (auto &running : runningTasks_)
+            {
+                if (running.second != nullptr)
+                    running.second->cancel();
+            }
+        }
+        notEmpty_.notify_all(); // 唤醒所有线程，让其退出
+        notFull_.notify_all();  // 唤醒等待队列空余的提交者，让其失败返回
+
+        auto exited = [&]() -> bool
+        { return curThreadSize_ == 0; };
+        if (timeoutMs < 0)
+        {
+            exitCond_.wait(lock, exited);
+        }
+        else if (!exitCond_.wait_for(lock, std::chrono::milliseconds(timeoutMs), exited))
+        {
+            return false;
+        }
+        // 所有线程函数都已返回，取出线程对象在锁外 join
+        for (auto &thread : threads_)
+        {
+            joinThreads.emplace_back(std::move(thread.second));
+        }
+        threads_.clear();
+        for (auto &thread : exitedThreads_)
+        {
+            joinThreads.emplace_back(std::move(thread));
+        }
+        exitedThreads_.clear();
+        idleThreadSize_ = 0;
+    }
+    for (auto &thread : joinThreads)
+    {
+        thread->join();
+    }
+    return true;
 }
 
 void ThreadPool::setMode(PoolMode mode)
@@ -59,60 +131,215 @@ void ThreadPool::setThreadSizeMaxThreshHold(int size)
     }
 }
 
+void ThreadPool::setThreadMaxIdleTime(int seconds)
+{
+    if (checkRunningState())
+        return;
+    threadMaxIdleTime_ = seconds;
+}
+
+void ThreadPool::setThreadStackSize(size_t stackSize, size_t guardSize)
+{
+    if (checkRunningState())
+        return;
+    threadStackSize_ = stackSize;
+    threadGuardSize_ = guardSize;
+}
+
+void ThreadPool::setLazySpawn(bool lazy)
+{
+    if (checkRunningState())
+        return;
+    lazySpawn_ = lazy;
+}
+
+int ThreadPool::getInitThreadSize() const
+{
+    return initThreadSize_;
+}
+
+int ThreadPool::getThreadSize() const
+{
+    return curThreadSize_;
+}
+
+int ThreadPool::getIdleThreadSize() const
+{
+    return idleThreadSize_;
+}
+
+int ThreadPool::getTaskSize() const
+{
+    return taskSize_;
+}
+
+bool ThreadPool::addGroup(const std::string &name, int weight, int maxConcurrency, int queMaxThreshHold)
+{
+    std::unique_lock<std::mutex> lock(taskQueMtx_);
+    if (weight <= 0 || groupIndex_.count(name) > 0)
+    {
+        std::cerr << "add group " << name << " fail" << std::endl;
+        return false;
+    }
+    auto group = std::make_unique<TaskGroup>();
+    group->name_ = name;
+    group->weight_ = weight;
+    group->maxConcurrency_ = maxConcurrency;
+    group->queMaxThreshHold_ = queMaxThreshHold;
+    group->deficit_ = groups_.empty() ? weight : 0;
+    group->running_ = 0;
+    group->submitted_ = 0;
+    group->rejected_ = 0;
+    group->completed_ = 0;
+    groupIndex_.emplace(name, groups_.size());
+    groups_.emplace_back(std::move(group));
+    return true;
+}
+
+bool ThreadPool::getGroupStats(const std::string &name, GroupStats &stats)
+{
+    std::unique_lock<std::mutex> lock(taskQueMtx_);
+    auto it = groupIndex_.find(name);
+    if (it == groupIndex_.end())
+        return false;
+    const TaskGroup &group = *groups_[it->second];
+    stats.name = group.name_;
+    stats.weight = group.weight_;
+    stats.maxConcurrency = group.maxConcurrency_;
+    stats.queMaxThreshHold = group.queMaxThreshHold_ > 0 ? group.queMaxThreshHold_ : taskQueMaxThreshHold_;
+    stats.queued = group.taskQue_.size();
+    stats.running = group.running_;
+    stats.submitted = group.submitted_;
+    stats.rejected = group.rejected_;
+    stats.completed = group.completed_;
+    return true;
+}
+
 Result ThreadPool::submitTask(std::shared_ptr<Task> sp)
+{
+    // 获取锁，默认分组下标固定为 0
+    std::unique_lock<std::mutex> lock(taskQueMtx_);
+    return submitTask(std::move(sp), 0, lock, std::chrono::seconds(1));
+}
+
+Result ThreadPool::trySubmitTask(std::shared_ptr<Task> sp)
+{
+    std::unique_lock<std::mutex> lock(taskQueMtx_);
+    return submitTask(std::move(sp), 0, lock, std::chrono::milliseconds(0));
+}
+
+Result ThreadPool::submitTask(std::shared_ptr<Task> sp, const std::string &group)
 {
     // 获取锁
     std::unique_lock<std::mutex> lock(taskQueMtx_);
-    // 线程通信，等待任务队列有空余
-    if (!notFull_.wait_for(lock, std::chrono::seconds(1), [&]() -> bool
-                           { return taskQueue_.size() < (size_t)taskQueMaxThreshHold_; }))
+    auto it = groupIndex_.find(group);
+    if (it == groupIndex_.end())
     {
-        // 等待 1 秒还是没满足
-        std::cerr << "taskQue is full, submit task fail" << std::endl;
-        return Result(sp, false);
+        std::cerr << "group " << group << " not found, submit task fail" << std::endl;
+        return Result(std::move(sp), false);
     }
-    // 如果有空，把任务放入任务队列
-    taskQueue_.emplace(sp);
-    taskSize_++;
-    // 放入队列，队列不空，在 notEmpty_通知
-    notEmpty_.notify_all();
+    return submitTask(std::move(sp), it->second, lock, std::chrono::seconds(1));
+}
 
+Result ThreadPool::submitTask(std::shared_ptr<Task> &&sp, size_t index, std::unique_lock<std::mutex> &lock,
+                              std::chrono::milliseconds timeout)
+{
+    if (!isPoolRunning_)
+    {
+        std::cerr << "pool is not running, submit task fail" << std::endl;
+        return Result(std::move(sp), false);
+    }
+    TaskGroup *pg = groups_[index].get();
+    // 每个分组使用独立的队列上限，一个分组占满队列不影响其他分组提交
+    size_t queMaxThreshHold = pg->queMaxThreshHold_ > 0 ? pg->queMaxThreshHold_ : taskQueMaxThreshHold_;
+    // 线程通信，等待任务队列有空余
+    if (!notFull_.wait_for(lock, timeout, [&]() -> bool
+                           { return !isPoolRunning_ || pg->taskQue_.size() < queMaxThreshHold; }) ||
+        !isPoolRunning_)
+    {
+        // 等待 timeout 还是没满足，不等待的提交由调用方处理失败，不打印
+        pg->rejected_++;
+        if (timeout.count() > 0)
+            std::cerr << "taskQue is full, submit task fail" << std::endl;
+        return Result(std::move(sp), false);
+    }
+    // 空闲线程不足时先创建线程：按需创建模式下 fixed 最多创建 initThreadSize_ 个线程
     // cache 模式，任务比较紧急。场景：小而快的任务，根据任务数量和空闲线程数量，动态增加线程
-    if (poolMode_ == PoolMode::MODE_CACHED && taskSize_ > idleThreadSize_ && curThreadSize_ < threadSizeThreshHold_)
+    // 只统计能立即执行的任务，达到并发上限的分组排队再多也不增加线程
+    // 持有锁，新线程在任务入队之前取不到任务
+    bool runnable = pg->maxConcurrency_ <= 0 || (int)pg->taskQue_.size() + pg->running_ < pg->maxConcurrency_;
+    int threadLimit = poolMode_ == PoolMode::MODE_CACHED ? threadSizeThreshHold_ : (int)initThreadSize_;
+    if (runnable && dispatchableTaskSize() + 1 > (size_t)idleThreadSize_ && curThreadSize_ < threadLimit)
     {
         std::cout << "create new thread" << std::endl;
-        // 创建一个线程对象，并启动
-        auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-        int threadId = ptr->getId();
-        threads_.emplace(threadId, std::move(ptr));
-        threads_[threadId]->start();
-        curThreadSize_++;
-        idleThreadSize_++;
+        // 回收之前因空闲超时退出的线程
+        for (auto &thread : exitedThreads_)
+        {
+            thread->join();
+        }
+        exitedThreads_.clear();
+        // 创建失败时由已有线程执行任务，一个线程都没有则提交失败
+        if (!createThread() && curThreadSize_ == 0)
+        {
+            pg->rejected_++;
+            std::cerr << "no thread to run task, submit task fail" << std::endl;
+            return Result(std::move(sp), false);
+        }
     }
-    return Result(sp);
+
+    // 先创建 Result，任务入队后可能立即被执行
+    // sp 从调用方一路移动到队列中，只有 Result 持有的这一份会增加引用计数
+    Result result(sp);
+    // 如果有空，把任务放入任务队列
+    pg->taskQue_.emplace(std::move(sp));
+    pg->submitted_++;
+    taskSize_++;
+    // 放入队列，队列不空，在 notEmpty_通知
+    notEmpty_.notify_all();
+    return result;
 }
 void ThreadPool::start(int initThreadSize)
 {
+    std::unique_lock<std::mutex> lock(taskQueMtx_);
+    // 已经启动，或者上一次 shutdown 超时还有线程没有退出
+    if (isPoolRunning_ || curThreadSize_ > 0)
+        return;
     // 设置线程池运行状态
     isPoolRunning_ = true;
     // 记录初始线程个数
     initThreadSize_ = initThreadSize;
-    curThreadSize_ = initThreadSize;
 
-    // 创建线程对象
-    for (int i = 0; i < initThreadSize_; i++)
+    // 按需创建模式下线程在提交任务时创建
+    if (lazySpawn_)
+        return;
+    // 创建并启动线程，直接使用新建的线程对象，线程 id 是全局递增的，不能按下标访问 threads_
+    // 创建失败时停止创建，提交任务时会再次尝试
+    for (int i = 0; i < initThreadSize; i++)
     {
-        auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1));
-        int threadId = ptr->getId();
-        threads_.emplace(threadId, std::move(ptr));
+        if (!createThread())
+            break;
     }
+}
 
-    // 启动所有线程
-    for (int i = 0; i < initThreadSize_; i++)
+bool ThreadPool::createThread()
+{
+    auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFunc, this, std::placeholders::_1),
+                                        threadStackSize_, threadGuardSize_);
+    // 先启动再登记：调用方持有 taskQueMtx_，线程函数在登记完成之前拿不到锁；启动失败不留下任何状态
+    try
     {
-        threads_[i]->start();
-        idleThreadSize_++;
+        ptr->start();
     }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    int threadId = ptr->getId();
+    threads_.emplace(threadId, std::move(ptr));
+    curThreadSize_++;
+    idleThreadSize_++;
+    return true;
 }
 
 // 自定义线程函数，从任务队列取任务，体现了一个线程的生命周期
@@ -123,6 +350,7 @@ void ThreadPool::threadFunc(int threadId)
     for (;;)
     {
         std::shared_ptr<Task> task;
+        TaskGroup *group = nullptr;
         {
             std::unique_lock<std::mutex> lock(taskQueMtx_);
 
@@ -130,13 +358,14 @@ void ThreadPool::threadFunc(int threadId)
             std::cout << "tid=" << threadId << " try to get task" << std::endl;
             // cache 模式下，线程空闲超过 60 秒，自动结束多余的线程(超过 initThreadSize_的线程)
 
-            // 当任务队列为空的时候，线程的逻辑
-            while (taskQueue_.size() == 0)
+            // 当没有可调度任务的时候，线程的逻辑
+            while ((group = pickGroup()) == nullptr)
             {
-                // 线程池被关闭的逻辑
-                if (!isPoolRunning_)
+                // 线程池被关闭且任务全部取走的逻辑
+                if (!isPoolRunning_ && taskSize_ == 0)
                 {
-                    threads_.erase(threadId);
+                    // 线程对象留在 threads_ 中，由 shutdown 统一 join
+                    runningTasks_.erase(threadId);
                     curThreadSize_--;
                     idleThreadSize_--;
                     exitCond_.notify_all();
@@ -153,12 +382,14 @@ void ThreadPool::threadFunc(int threadId)
                     {
                         auto nowTime = std::chrono::high_resolution_clock::now();
                         auto dur = std::chrono::duration_cast<std::chrono::seconds>(nowTime - lastTime);
-                        if (dur.count() >= THREAD_MAX_IDLE_TIME && curThreadSize_ > initThreadSize_)
+                        if (dur.count() >= threadMaxIdleTime_ && curThreadSize_ > initThreadSize_)
                         {
                             // 开始回收当前线程
                             // 记录线程数量的相关变量的值修改
-                            // 把线程对象从线程列表容器里面删除
+                            // 把线程对象从线程列表移到待 join 列表，线程不能 join 自己
+                            exitedThreads_.emplace_back(std::move(threads_[threadId]));
                             threads_.erase(threadId);
+                            runningTasks_.erase(threadId);
                             curThreadSize_--;
                             idleThreadSize_--;
                             //std::cout << "threadid=" << std::this_thread::get_id() << " exit" << std::endl;
@@ -174,13 +405,15 @@ void ThreadPool::threadFunc(int threadId)
             }
             idleThreadSize_--;
 
-            task = taskQueue_.front();
-            taskQueue_.pop();
+            task = std::move(group->taskQue_.front());
+            group->taskQue_.pop();
+            group->running_++;
+            runningTasks_[threadId] = task.get();
             taskSize_--;
             //std::cout << "tid=" << std::this_thread::get_id() << " get task" << std::endl;
             std::cout << "tid=" << threadId << " get task" << std::endl;
             // 有剩余任务，通知其他线程
-            if (taskQueue_.size() > 0)
+            if (taskSize_ > 0)
             {
                 notEmpty_.notify_all();
             }
@@ -193,6 +426,18 @@ void ThreadPool::threadFunc(int threadId)
         {
             task->exec();
         }
+        {
+            std::unique_lock<std::mutex> lock(taskQueMtx_);
+            // 只清空不删除，避免每个任务都分配哈希表节点
+            runningTasks_[threadId] = nullptr;
+            group->running_--;
+            group->completed_++;
+            // 分组可能因并发上限有任务在等待，唤醒线程重新调度
+            if (!group->taskQue_.empty())
+            {
+                notEmpty_.notify_all();
+            }
+        }
         idleThreadSize_++;
 
         // 更新线程的空闲时间点
@@ -205,8 +450,185 @@ bool ThreadPool::checkRunningState() const
     return isPoolRunning_;
 }
 
+// 赤字轮转(Deficit Round Robin)：每轮分组获得 weight_ 个调度额度，
+// 额度用完、队列为空或达到并发上限时轮到下一个分组
+ThreadPool::TaskGroup *ThreadPool::pickGroup()
+{
+    size_t n = groups_.size();
+    for (size_t i = 0; i <= n; i++)
+    {
+        TaskGroup *group = groups_[rrIndex_].get();
+        if (group->deficit_ > 0 && group->dispatchable())
+        {
+            group->deficit_--;
+            return group;
+        }
+        // 放弃本轮剩余额度，避免空闲分组积攒额度后突发占满线程
+        group->deficit_ = 0;
+        rrIndex_ = (rrIndex_ + 1) % n;
+        groups_[rrIndex_]->deficit_ = groups_[rrIndex_]->weight_;
+    }
+    return nullptr;
+}
+
+size_t ThreadPool::dispatchableTaskSize() const
+{
+    size_t size = 0;
+    for (const auto &group : groups_)
+    {
+        size += group->dispatchableSize();
+    }
+    return size;
+}
+
 //////////线程类方法实现
-int Thread::generateId_ = 0;
+// 进程级系统线程缓存：线程函数结束后系统线程停放在这里，等待下一个线程函数
+// 只按栈大小和保护区大小相同的线程复用；缓存对象永不析构，避免进程退出时停放的线程访问已析构的对象
+class ThreadCache
+{
+public:
+    static ThreadCache &instance()
+    {
+        static ThreadCache *cache = new ThreadCache();
+        return *cache;
+    }
+
+    // 在系统线程上运行 job，优先复用停放的线程
+    void run(std::function<void()> job, size_t stackSize, size_t guardSize)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            // 从末尾查找，最近停放的线程栈更可能还在缓存中
+            for (auto it = parked_.rbegin(); it != parked_.rend(); ++it)
+            {
+                Worker *worker = *it;
+                if (worker->stackSize_ == stackSize && worker->guardSize_ == guardSize)
+                {
+                    parked_.erase(std::next(it).base());
+                    worker->job_ = std::move(job);
+                    worker->cond_.notify_one();
+                    return;
+                }
+            }
+        }
+
+        Worker *worker = new Worker(std::move(job), stackSize, guardSize);
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (stackSize > 0)
+            pthread_attr_setstacksize(&attr, std::max<size_t>(stackSize, PTHREAD_STACK_MIN));
+        if (guardSize > 0)
+            pthread_attr_setguardsize(&attr, guardSize);
+        pthread_t tid;
+        int ret = pthread_create(&tid, &attr, &ThreadCache::threadMain, worker);
+        pthread_attr_destroy(&attr);
+        if (ret != 0)
+        {
+            delete worker;
+            throw std::runtime_error("create thread fail");
+        }
+    }
+
+    void setCapacity(size_t capacity)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        capacity_ = capacity;
+        // 唤醒超出容量的停放线程，让其退出
+        while (parked_.size() > capacity_)
+        {
+            Worker *worker = parked_.front();
+            parked_.erase(parked_.begin());
+            worker->exit_ = true;
+            worker->cond_.notify_one();
+        }
+    }
+
+    size_t parkedSize()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return parked_.size();
+    }
+
+private:
+    struct Worker
+    {
+        Worker(std::function<void()> job, size_t stackSize, size_t guardSize)
+            : job_(std::move(job)), stackSize_(stackSize), guardSize_(guardSize), exit_(false) {}
+        std::function<void()> job_;
+        size_t stackSize_;
+        size_t guardSize_;
+        bool exit_;
+        std::condition_variable cond_;
+    };
+
+    ThreadCache() : capacity_(THREAD_CACHE_CAPACITY)
+    {
+        pthread_atfork(&ThreadCache::beforeFork, &ThreadCache::afterForkParent, &ThreadCache::afterForkChild);
+    }
+
+    // fork 前持有 mtx_，保证子进程中的 parked_ 是一致的
+    static void beforeFork()
+    {
+        instance().mtx_.lock();
+    }
+    static void afterForkParent()
+    {
+        instance().mtx_.unlock();
+    }
+    // 子进程只有调用 fork 的线程，停放的系统线程都不存在，丢弃缓存，之后的线程重新创建
+    // Worker 对象不释放：其条件变量可能仍记录着父进程中的等待者，销毁不安全
+    static void afterForkChild()
+    {
+        ThreadCache &cache = instance();
+        cache.parked_.clear();
+        cache.mtx_.unlock();
+    }
+
+    static void *threadMain(void *arg)
+    {
+        Worker *worker = static_cast<Worker *>(arg);
+        ThreadCache &cache = instance();
+        for (;;)
+        {
+            std::function<void()> job = std::move(worker->job_);
+            worker->job_ = nullptr;
+            job();
+            job = nullptr;
+
+            std::unique_lock<std::mutex> lock(cache.mtx_);
+            if (cache.parked_.size() >= cache.capacity_)
+                break;
+            cache.parked_.push_back(worker);
+            bool woken = worker->cond_.wait_for(lock, std::chrono::seconds(THREAD_CACHE_IDLE_TIME), [&]() -> bool
+                                                { return worker->job_ != nullptr || worker->exit_; });
+            if (!woken)
+            {
+                // 空闲超时，从缓存中移除后退出
+                cache.parked_.erase(std::find(cache.parked_.begin(), cache.parked_.end(), worker));
+                break;
+            }
+            if (worker->exit_)
+                break;
+        }
+        delete worker;
+        return nullptr;
+    }
+
+    std::mutex mtx_;
+    size_t capacity_;
+    std::vector<Worker *> parked_;
+};
+
+// 线程函数的完成状态，Thread::join 等待 done_
+struct ThreadState
+{
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    bool done_ = false;
+};
+
+std::atomic_int Thread::generateId_(0);
 
 int Thread::getId() const
 {
@@ -215,53 +637,114 @@ int Thread::getId() const
 
 void Thread::start()
 {
-    // 创建一个线程来执行一个函数
-    std::thread t(func_, threadId_);
-    t.detach();
+    // 在缓存提供的系统线程上执行线程函数，启动成功之后才记录状态，启动失败时 join 直接返回
+    auto state = std::make_shared<ThreadState>();
+    ThreadCache::instance().run([func = func_, threadId = threadId_, state]()
+                                {
+        func(threadId);
+        std::unique_lock<std::mutex> lock(state->mtx_);
+        state->done_ = true;
+        state->cond_.notify_all(); },
+                                stackSize_, guardSize_);
+    state_ = state;
 }
 
-Thread::Thread(ThreadFunc func)
-    : func_(func), threadId_(generateId_++)
+void Thread::join()
 {
+    if (state_ == nullptr)
+        return;
+    std::unique_lock<std::mutex> lock(state_->mtx_);
+    state_->cond_.wait(lock, [&]() -> bool
+                       { return state_->done_; });
 }
 
-Thread::~Thread() {}
+void Thread::setCacheCapacity(size_t capacity)
+{
+    ThreadCache::instance().setCapacity(capacity);
+}
 
-///////////////////////Task 实现
+size_t Thread::getParkedThreadSize()
+{
+    return ThreadCache::instance().parkedSize();
+}
+
+Thread::Thread(ThreadFunc func, size_t stackSize, size_t guardSize)
+    : func_(func), threadId_(generateId_++), stackSize_(stackSize), guardSize_(guardSize)
+{
+}
 
-Task::Task()
-    : result_(nullptr)
+Thread::~Thread()
 {
+    join();
 }
 
+///////////////////////Task 实现
+
 void Task::exec()
 {
-    if (result_ == nullptr)
-        return;
-    result_->setVal(run());
+    state_.setVal(run());
+}
+
+ResultState &Task::state()
+{
+    return state_;
+}
+
+void Task::cancel()
+{
+    cancelled_ = true;
 }
 
-void Task::setResult(Result *res)
+bool Task::isCancelled() const
 {
-    result_ = res;
+    return cancelled_;
+}
+
+///////////////////////ResultState 方法实现
+Any ResultState::get()
+{
+    sem_.wait(); // task 任务如果没有执行完毕
+    return std::move(any_);
+}
+
+void ResultState::setVal(Any any)
+{
+    this->any_ = std::move(any);
+    sem_.post();
+}
+
+///////////////////////TaskFreeList 方法实现
+std::atomic<size_t> TaskFreeList::nextSlot_(0);
+
+TaskFreeList::~TaskFreeList()
+{
+    for (auto &list : lists_)
+    {
+        for (void *p : list)
+        {
+            ::operator delete(p);
+        }
+    }
 }
 
 ///////////////////////Result 方法实现
-Result::Result(std::shared_ptr<Task> task, bool isValid) : task_(task), isValid_(isValid)
+Result::Result(std::shared_ptr<Task> task, bool isValid) : task_(std::move(task)), isValid_(isValid)
 {
-    task_->setResult(this);
 }
 
 Any Result::get()
 {
     if (!isValid_)
         return "";
-    sem_.wait(); // task 任务如果没有执行完毕
-    return std::move(any_);
+    return task_->state().get();
+}
+
+bool Result::isValid() const
+{
+    return isValid_;
 }
 
 void Result::setVal(Any any)
 {
-    this->any_ = std::move(any);
-    sem_.post();
-}
\ No newline at end of file
+    task_->state().setVal(std::move(any));
+}
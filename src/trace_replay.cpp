@@ -0,0 +1,509 @@
+#include "../include/threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+任务轨迹回放工具：读取任务轨迹文件，按 1x..Nx 的速度驱动一个真实的 ThreadPool，
+统计吞吐量、排队时间、延迟分位数、线程利用率和线程数量随时间的变化，用于离线评估线程池配置。
+
+轨迹文件为 CSV，每行一个任务（# 开头的行和表头行会被忽略）：
+    id,arrival_us,cpu_us,block_us,priority,deps
+    deps 为依赖的任务 id，用 ; 分隔，可以为空；任务在到达且依赖全部完成后才提交
+    priority 映射为线程池分组 "prio<N>"，权重为 N+1
+
+用法：
+    ThreadPool_replay <trace.csv> [--speed 1] [--mode fixed|cached] [--threads 4]
+                      [--max-threads 100] [--queue 1024] [--idle 60] [--sample-ms 100]
+    ThreadPool_replay --gen <count> [--rate 2000] > trace.csv   生成一个合成轨迹
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct TraceRecord
+{
+    int id;
+    long long arrivalUs;
+    long long cpuUs;
+    long long blockUs;
+    int priority;
+    std::vector<int> deps;
+};
+
+// 单个任务的回放状态，时间均为相对回放开始的微秒数
+struct TaskTiming
+{
+    long long arrivalUs = 0; // 按回放速度缩放后的到达时间
+    long long submitUs = -1;
+    long long startUs = -1;
+    long long endUs = -1;
+    int remainingDeps = 0;
+    bool arrived = false;
+    bool dropped = false;
+};
+
+struct Sample
+{
+    long long timeUs;
+    int threads;
+    int idle;
+    int queued;
+};
+
+// 回放过程中工作线程和驱动线程共享的状态
+class ReplayContext
+{
+public:
+    explicit ReplayContext(size_t size) : timings_(size), startTime_(Clock::now()) {}
+
+    long long nowUs() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startTime_).count();
+    }
+
+    // 工作线程完成任务后调用，通知驱动线程检查依赖
+    void complete(size_t index)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        completed_.push_back(index);
+        cond_.notify_all();
+    }
+
+    std::vector<TaskTiming> timings_;
+    std::vector<size_t> completed_; // 已完成但驱动线程还未处理的任务下标
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    Clock::time_point startTime_;
+};
+
+class ReplayTask : public Task
+{
+public:
+    ReplayTask(ReplayContext *ctx, size_t index, long long cpuUs, long long blockUs)
+        : ctx_(ctx), index_(index), cpuUs_(cpuUs), blockUs_(blockUs) {}
+
+    Any run() override
+    {
+        TaskTiming &timing = ctx_->timings_[index_];
+        timing.startUs = ctx_->nowUs();
+        // 忙等模拟 CPU 开销
+        auto cpuEnd = Clock::now() + std::chrono::microseconds(cpuUs_);
+        volatile unsigned long spin = 0;
+        while (Clock::now() < cpuEnd)
+        {
+            spin = spin + 1;
+        }
+        // 睡眠模拟阻塞等待（IO、锁等）
+        if (blockUs_ > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(blockUs_));
+        }
+        timing.endUs = ctx_->nowUs();
+        ctx_->complete(index_);
+        return 0;
+    }
+
+private:
+    ReplayContext *ctx_;
+    size_t index_;
+    long long cpuUs_;
+    long long blockUs_;
+};
+
+static bool parseTrace(const std::string &path, std::vector<TraceRecord> &records)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "open trace file " << path << " fail" << std::endl;
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line))
+    {
+        lineNo++;
+        if (line.empty() || line[0] == '#' || line.compare(0, 2, "id") == 0)
+            continue;
+        std::stringstream ss(line);
+        std::string field;
+        std::vector<std::string> fields;
+        while (std::getline(ss, field, ','))
+        {
+            fields.push_back(field);
+        }
+        if (fields.size() < 5)
+        {
+            std::cerr << "trace line " << lineNo << " has too few fields" << std::endl;
+            return false;
+        }
+        TraceRecord record;
+        record.id = std::atoi(fields[0].c_str());
+        record.arrivalUs = std::atoll(fields[1].c_str());
+        record.cpuUs = std::atoll(fields[2].c_str());
+        record.blockUs = std::atoll(fields[3].c_str());
+        record.priority = std::max(0, std::atoi(fields[4].c_str()));
+        if (fields.size() > 5)
+        {
+            std::stringstream deps(fields[5]);
+            std::string dep;
+            while (std::getline(deps, dep, ';'))
+            {
+                if (!dep.empty())
+                    record.deps.push_back(std::atoi(dep.c_str()));
+            }
+        }
+        records.push_back(std::move(record));
+    }
+    std::stable_sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b)
+                     { return a.arrivalUs < b.arrivalUs; });
+    return true;
+}
+
+// 生成合成轨迹：泊松到达，CPU/阻塞时间指数分布，约 10% 的任务依赖之前的某个任务
+static void generateTrace(int count, double rate)
+{
+    std::mt19937_64 rng(42);
+    std::exponential_distribution<double> interArrival(rate / 1e6);
+    std::exponential_distribution<double> cpu(1.0 / 200);
+    std::exponential_distribution<double> block(1.0 / 500);
+    std::uniform_int_distribution<int> priority(0, 2);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::cout << "id,arrival_us,cpu_us,block_us,priority,deps" << std::endl;
+    double arrival = 0;
+    for (int i = 0; i < count; i++)
+    {
+        arrival += interArrival(rng);
+        std::cout << i << ',' << (long long)arrival << ',' << (long long)cpu(rng) << ','
+                  << (uniform(rng) < 0.3 ? (long long)block(rng) : 0) << ',' << priority(rng) << ',';
+        if (i > 0 && uniform(rng) < 0.1)
+        {
+            std::cout << std::uniform_int_distribution<int>(std::max(0, i - 50), i - 1)(rng);
+        }
+        std::cout << '\n';
+    }
+}
+
+static void printPercentiles(const char *name, std::vector<long long> values)
+{
+    if (values.empty())
+    {
+        std::cout << std::setw(12) << name << "  (no data)" << std::endl;
+        return;
+    }
+    std::sort(values.begin(), values.end());
+    auto pct = [&](double p) -> double
+    {
+        size_t idx = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+        return values[idx] / 1000.0;
+    };
+    std::cout << std::setw(12) << name << std::fixed << std::setprecision(3)
+              << "  p50=" << pct(0.50) << "ms p90=" << pct(0.90) << "ms p99=" << pct(0.99)
+              << "ms max=" << values.back() / 1000.0 << "ms" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string tracePath;
+    double speed = 1.0;
+    PoolMode mode = PoolMode::MODE_FIXED;
+    int threads = std::thread::hardware_concurrency();
+    int maxThreads = 0;
+    int queueSize = 0;
+    int idleTime = 0;
+    int sampleMs = 100;
+    int genCount = 0;
+    double genRate = 2000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char *
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        if (arg == "--speed")
+            speed = std::atof(next());
+        else if (arg == "--mode")
+            mode = std::string(next()) == "cached" ? PoolMode::MODE_CACHED : PoolMode::MODE_FIXED;
+        else if (arg == "--threads")
+            threads = std::atoi(next());
+        else if (arg == "--max-threads")
+            maxThreads = std::atoi(next());
+        else if (arg == "--queue")
+            queueSize = std::atoi(next());
+        else if (arg == "--idle")
+            idleTime = std::atoi(next());
+        else if (arg == "--sample-ms")
+            sampleMs = std::max(1, std::atoi(next()));
+        else if (arg == "--gen")
+            genCount = std::atoi(next());
+        else if (arg == "--rate")
+            genRate = std::atof(next());
+        else
+            tracePath = arg;
+    }
+
+    if (genCount > 0)
+    {
+        generateTrace(genCount, genRate);
+        return 0;
+    }
+    if (tracePath.empty() || speed <= 0)
+    {
+        std::cerr << "usage: " << argv[0] << " <trace.csv> [--speed 1] [--mode fixed|cached] [--threads N]"
+                  << " [--max-threads N] [--queue N] [--idle SEC] [--sample-ms MS]" << std::endl
+                  << "       " << argv[0] << " --gen <count> [--rate tasks_per_sec]" << std::endl;
+        return 1;
+    }
+
+    std::vector<TraceRecord> records;
+    if (!parseTrace(tracePath, records))
+        return 1;
+
+    // 建立 id 到下标的映射和依赖关系
+    std::unordered_map<int, size_t> indexOf;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        indexOf[records[i].id] = i;
+    }
+    ReplayContext ctx(records.size());
+    std::vector<std::vector<size_t>> dependents(records.size());
+    std::map<int, std::string> groupOf;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        for (int dep : records[i].deps)
+        {
+            auto it = indexOf.find(dep);
+            if (it == indexOf.end() || it->second == i)
+            {
+                std::cerr << "task " << records[i].id << " depends on unknown task " << dep << ", ignored" << std::endl;
+                continue;
+            }
+            dependents[it->second].push_back(i);
+            ctx.timings_[i].remainingDeps++;
+        }
+        ctx.timings_[i].arrivalUs = (long long)(records[i].arrivalUs / speed);
+        groupOf.emplace(records[i].priority, "prio" + std::to_string(records[i].priority));
+    }
+
+    // 拓扑排序检测依赖环：环上的任务和依赖它们的任务永远不会就绪，直接丢弃，否则回放无法结束
+    size_t cyclic = 0;
+    {
+        std::vector<int> indegree(records.size());
+        std::vector<size_t> ready;
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            indegree[i] = ctx.timings_[i].remainingDeps;
+            if (indegree[i] == 0)
+                ready.push_back(i);
+        }
+        while (!ready.empty())
+        {
+            size_t index = ready.back();
+            ready.pop_back();
+            for (size_t dependent : dependents[index])
+            {
+                if (--indegree[dependent] == 0)
+                    ready.push_back(dependent);
+            }
+        }
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            if (indegree[i] > 0)
+            {
+                std::cerr << "task " << records[i].id << " is in or depends on a dependency cycle, dropped" << std::endl;
+                ctx.timings_[i].dropped = true;
+                cyclic++;
+            }
+        }
+    }
+
+    // 屏蔽线程池的调试输出，回放结束后恢复
+    std::streambuf *coutBuf = std::cout.rdbuf(nullptr);
+    std::vector<Sample> samples;
+    std::mutex sampleMtx;
+    size_t finished = cyclic;
+    long long elapsedUs = 0;
+    std::vector<GroupStats> groupStats;
+    {
+        ThreadPool pool;
+        pool.setMode(mode);
+        if (maxThreads > 0)
+            pool.setThreadSizeMaxThreshHold(maxThreads);
+        if (queueSize > 0)
+            pool.setTaskQueMaxThreshHold(queueSize);
+        if (idleTime > 0)
+            pool.setThreadMaxIdleTime(idleTime);
+        for (auto &group : groupOf)
+        {
+            pool.addGroup(group.second, group.first + 1);
+        }
+        ctx.startTime_ = Clock::now();
+        pool.start(threads);
+
+        // 采样线程，定期记录线程数量和排队任务数量
+        // 驱动线程提交任务后线程数量变化时也记录一次，按需创建的线程从创建时刻起计入线程时间
+        auto sample = [&](bool onChange)
+        {
+            std::unique_lock<std::mutex> lock(sampleMtx);
+            int threadSize = pool.getThreadSize();
+            if (onChange && !samples.empty() && samples.back().threads == threadSize)
+                return;
+            samples.push_back({ctx.nowUs(), threadSize, pool.getIdleThreadSize(), pool.getTaskSize()});
+        };
+        std::atomic_bool sampling(true);
+        std::thread sampler([&]()
+                            {
+            while (sampling)
+            {
+                sample(false);
+                std::this_thread::sleep_for(std::chrono::milliseconds(sampleMs));
+            } });
+
+        // 提交一个任务，提交失败时级联丢弃依赖它的任务
+        std::function<void(size_t)> drop;
+        drop = [&](size_t index)
+        {
+            TaskTiming &timing = ctx.timings_[index];
+            if (timing.dropped)
+                return;
+            timing.dropped = true;
+            finished++;
+            for (size_t dependent : dependents[index])
+            {
+                drop(dependent);
+            }
+        };
+        auto submit = [&](size_t index)
+        {
+            TaskTiming &timing = ctx.timings_[index];
+            timing.submitUs = ctx.nowUs();
+            const TraceRecord &record = records[index];
+            Result res = pool.submitTask(pool.makeTask<ReplayTask>(&ctx, index, record.cpuUs, record.blockUs),
+                                         groupOf[record.priority]);
+            if (!res.isValid())
+            {
+                drop(index);
+            }
+            sample(true);
+        };
+
+        size_t nextArrival = 0;
+        while (finished < records.size())
+        {
+            // 处理已完成任务，释放依赖它们的任务
+            std::vector<size_t> completed;
+            {
+                std::unique_lock<std::mutex> lock(ctx.mtx_);
+                if (ctx.completed_.empty())
+                {
+                    if (nextArrival < records.size())
+                    {
+                        auto deadline = ctx.startTime_ + std::chrono::microseconds(ctx.timings_[nextArrival].arrivalUs);
+                        ctx.cond_.wait_until(lock, deadline);
+                    }
+                    else
+                    {
+                        ctx.cond_.wait(lock, [&]() -> bool
+                                       { return !ctx.completed_.empty(); });
+                    }
+                }
+                completed.swap(ctx.completed_);
+            }
+            for (size_t index : completed)
+            {
+                finished++;
+                for (size_t dependent : dependents[index])
+                {
+                    TaskTiming &timing = ctx.timings_[dependent];
+                    if (--timing.remainingDeps == 0 && timing.arrived && !timing.dropped)
+                    {
+                        submit(dependent);
+                    }
+                }
+            }
+            // 提交所有已经到达的任务
+            long long now = ctx.nowUs();
+            while (nextArrival < records.size() && ctx.timings_[nextArrival].arrivalUs <= now)
+            {
+                TaskTiming &timing = ctx.timings_[nextArrival];
+                timing.arrived = true;
+                if (timing.remainingDeps == 0 && !timing.dropped)
+                {
+                    submit(nextArrival);
+                }
+                nextArrival++;
+            }
+        }
+        elapsedUs = ctx.nowUs();
+        sampling = false;
+        sampler.join();
+        for (auto &group : groupOf)
+        {
+            GroupStats stats;
+            if (pool.getGroupStats(group.second, stats))
+                groupStats.push_back(stats);
+        }
+    }
+    std::cout.rdbuf(coutBuf);
+
+    // 汇总统计
+    std::vector<long long> queueWait;
+    std::vector<long long> latency;
+    long long busyUs = 0;
+    size_t dropped = 0;
+    for (const TaskTiming &timing : ctx.timings_)
+    {
+        if (timing.dropped)
+        {
+            dropped++;
+            continue;
+        }
+        queueWait.push_back(timing.startUs - timing.submitUs);
+        latency.push_back(timing.endUs - timing.arrivalUs);
+        busyUs += timing.endUs - timing.startUs;
+    }
+    // 线程时间按采样点积分：每个采样点的线程数量乘以采样间隔
+    double threadUs = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        long long end = i + 1 < samples.size() ? samples[i + 1].timeUs : elapsedUs;
+        threadUs += (double)samples[i].threads * (end - samples[i].timeUs);
+    }
+
+    std::cout << "trace=" << tracePath << " tasks=" << records.size() << " speed=" << speed << "x"
+              << " mode=" << (mode == PoolMode::MODE_CACHED ? "cached" : "fixed") << " threads=" << threads << std::endl;
+    std::cout << std::fixed << std::setprecision(3)
+              << "elapsed=" << elapsedUs / 1e6 << "s completed=" << latency.size() << " dropped=" << dropped
+              << " throughput=" << (elapsedUs > 0 ? latency.size() * 1e6 / elapsedUs : 0) << " tasks/s" << std::endl;
+    printPercentiles("queue wait", queueWait);
+    printPercentiles("latency", latency);
+    // 采样点之间线程数量的变化仍可能漏计少量线程时间，利用率不超过 100%
+    std::cout << "utilization=" << (threadUs > 0 ? std::min(100.0, 100.0 * busyUs / threadUs) : 0) << "%" << std::endl;
+    for (const GroupStats &stats : groupStats)
+    {
+        std::cout << "group " << stats.name << " weight=" << stats.weight << " submitted=" << stats.submitted
+                  << " rejected=" << stats.rejected << " completed=" << stats.completed << std::endl;
+    }
+    std::cout << "time_ms,threads,idle,queued" << std::endl;
+    for (const Sample &sample : samples)
+    {
+        std::cout << sample.timeUs / 1000 << ',' << sample.threads << ',' << sample.idle << ',' << sample.queued << std::endl;
+    }
+    return 0;
+}